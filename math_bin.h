@@ -108,6 +108,10 @@ uint32_t mbin_grayA_inv32(uint32_t t);
 uint32_t mbin_grayA_fwd32(uint32_t t);
 uint32_t mbin_grayB_inv32(uint32_t t);
 uint32_t mbin_grayB_fwd32(uint32_t t);
+void	mbin_grayA_inv_array_32(const uint32_t *, uint32_t *, size_t);
+void	mbin_grayA_fwd_array_32(const uint32_t *, uint32_t *, size_t);
+void	mbin_grayB_inv_array_32(const uint32_t *, uint32_t *, size_t);
+void	mbin_grayB_fwd_array_32(const uint32_t *, uint32_t *, size_t);
 
 uint32_t mbin_recodeA_fwd32(uint32_t val, const uint8_t *premap);
 uint16_t mbin_recodeA_fwd16(uint16_t val, const uint8_t *premap);
@@ -118,13 +122,33 @@ void	mbin_recodeA_inv(const uint8_t *src, uint8_t *dst, uint8_t max);
 uint32_t mbin_recodeB_fwd32(uint32_t x, const uint32_t *ptr);
 uint32_t mbin_recodeB_inv32(uint32_t x, const uint32_t *ptr);
 
+#define	MBIN_RECODE_SHIFT 0
+#define	MBIN_RECODE_TABLE 1
+#define	MBIN_RECODE_ADD 2
+
+struct mbin_recode_plan {
+	uint32_t table[4][256];
+	uint32_t mask[32];
+	uint32_t value[32];
+	int8_t	shift[32];
+	uint8_t	count;
+	uint8_t	type;
+};
+
+void	mbin_recodeA_compile(struct mbin_recode_plan *, const uint8_t *premap);
+void	mbin_recodeB_compile(struct mbin_recode_plan *, const uint32_t *ptr);
+uint32_t mbin_recode_fwd32(const struct mbin_recode_plan *, uint32_t);
+void	mbin_recode_apply(const struct mbin_recode_plan *, const uint32_t *, uint32_t *, size_t);
+
 uint32_t mbin_polarise32(uint32_t val, uint32_t neg_pol);
 uint16_t mbin_polarise16(uint16_t val, uint16_t neg_pol);
 uint8_t	mbin_polarise8(uint8_t val, uint8_t neg_pol);
+void	mbin_polarise_array_32(const uint32_t *, uint32_t *, size_t, uint32_t neg_pol);
 
 uint32_t mbin_depolarise32(uint32_t val, uint32_t neg_pol);
 uint16_t mbin_depolarise16(uint16_t val, uint16_t neg_pol);
 uint8_t	mbin_depolarise8(uint8_t val, uint8_t neg_pol);
+void	mbin_depolarise_array_32(const uint32_t *, uint32_t *, size_t, uint32_t neg_pol);
 
 uint32_t mbin_depolar_div32(uint32_t rem, uint32_t div);
 uint16_t mbin_depolar_div16(uint16_t rem, uint16_t div);
@@ -151,6 +175,32 @@ uint32_t mbin_div_by3_32(uint32_t x);
 uint32_t mbin_div_by3_32_alt1(uint32_t x);
 uint32_t mbin_div3_gray_32(uint32_t r);
 
+struct mbin_baseN {
+	uint32_t n;
+	uint32_t stepmask;
+	uint32_t mul;
+	uint8_t	stepshift;
+	uint8_t	maxshift;
+	uint8_t	divshift;
+};
+
+/*
+ * Returns "a / n" using the reciprocal computed by
+ * mbin_baseN_init_32().
+ */
+static inline uint32_t
+mbin_baseN_div_32(const struct mbin_baseN *mb, uint32_t a)
+{
+	uint32_t t = ((uint64_t)a * mb->mul) >> 32;
+
+	return ((t + ((a - t) >> 1)) >> (mb->divshift - 1));
+}
+
+void	mbin_baseN_init_32(struct mbin_baseN *, uint32_t n);
+void	mbin_convert_2toN_array_32(const struct mbin_baseN *, const uint32_t *, uint32_t *, size_t);
+void	mbin_convert_Nto2_array_32(const struct mbin_baseN *, const uint32_t *, uint32_t *, size_t);
+void	mbin_add_baseN_array_32(const struct mbin_baseN *, const uint32_t *, const uint32_t *, uint32_t *, uint32_t f, size_t);
+void	mbin_mul_baseN_array_32(const struct mbin_baseN *, const uint32_t *, const uint32_t *, uint32_t *, size_t);
 uint32_t mbin_mul_baseN_32(uint32_t a, uint32_t b, uint32_t n);
 uint32_t mbin_add_baseN_32(uint32_t a, uint32_t b, uint32_t f, uint32_t n);
 uint32_t mbin_sub_baseN_32(uint32_t a, uint32_t b, uint32_t f, uint32_t n);
@@ -168,6 +218,8 @@ uint64_t mbin_bitrev64(uint64_t a);
 uint32_t mbin_bitrev32(uint32_t a);
 uint16_t mbin_bitrev16(uint16_t a);
 uint8_t	mbin_bitrev8(uint8_t a);
+void	mbin_bitrev_array_64(const uint64_t *, uint64_t *, size_t);
+void	mbin_bitrev_array_32(const uint32_t *, uint32_t *, size_t);
 
 /* baseL - prototypes */
 
@@ -193,6 +245,8 @@ struct mbin_baseM_bits32 {
 uint32_t mbin_baseM_next_32(uint32_t a1, uint32_t a0, uint32_t xor_val, uint32_t pol);
 uint32_t mbin_base_2toM_32(uint32_t bm, uint32_t xor_val, uint32_t pol_val);
 uint32_t mbin_base_Mto2_32(uint32_t bm, uint32_t xor_val, uint32_t pol_val);
+void	mbin_base_2toM_array_32(const uint32_t *, uint32_t *, size_t, uint32_t xor_val, uint32_t pol_val);
+void	mbin_base_Mto2_array_32(const uint32_t *, uint32_t *, size_t, uint32_t xor_val, uint32_t pol_val);
 void	mbin_baseM_get_state32(struct mbin_baseM_state32 *ps, uint32_t x, uint32_t xor_val, uint32_t pol_val);
 void	mbin_baseM_inc_state32(struct mbin_baseM_state32 *ps);
 uint32_t mbin_baseM_bits_slow_32(uint32_t x, uint32_t xor_val);
@@ -304,6 +358,8 @@ uint32_t mbin_inv_odd_prime_32(uint32_t val, uint32_t mod);
 uint64_t mbin_cos_b2_odd_64(uint64_t x);
 uint64_t mbin_sin_b2_odd_64(uint64_t x);
 uint64_t mbin_gcd_64(uint64_t, uint64_t);
+uint64_t mbin_gcd_extended_64(uint64_t, uint64_t, int64_t *, int64_t *);
+void	mbin_gcd_array_64(const uint64_t *, const uint64_t *, uint64_t *, size_t);
 void	mbin_log_table_gen_32(uint32_t *, uint32_t);
 uint32_t mbin_log_table_32(uint32_t, const uint32_t *, uint32_t);
 uint32_t mbin_exp_table_32(uint32_t, const uint32_t *, uint32_t);
@@ -317,6 +373,65 @@ uint64_t mbin_exp_non_linear_64(uint64_t a, uint64_t d);
 uint64_t mbin_factor_slow_64(uint64_t x);
 uint64_t mbin_factor_slower_64(uint64_t x);
 uint64_t mbin_factor_slowest_64(uint64_t x);
+uint8_t	mbin_is_prime_64(uint64_t x);
+uint64_t mbin_factor_fast_64(uint64_t x);
+
+struct mbin_mont_32 {
+	uint32_t n;
+	uint32_t ninv;			/* -n**-1 mod 2**32 */
+	uint32_t one;			/* 2**32 mod n */
+	uint32_t r2;			/* 2**64 mod n */
+};
+
+struct mbin_mont_64 {
+	uint64_t n;
+	uint64_t ninv;			/* -n**-1 mod 2**64 */
+	uint64_t one;			/* 2**64 mod n */
+	uint64_t r2;			/* 2**128 mod n */
+};
+
+void	mbin_mont_init_32(struct mbin_mont_32 *, uint32_t);
+uint32_t mbin_mont_power_32(const struct mbin_mont_32 *, uint32_t, uint32_t);
+void	mbin_mont_power_array_32(const struct mbin_mont_32 *, const uint32_t *, uint32_t *, uint32_t, size_t);
+uint32_t mbin_mont_inv_32(const struct mbin_mont_32 *, uint32_t);
+void	mbin_mont_init_64(struct mbin_mont_64 *, uint64_t);
+uint64_t mbin_mont_power_64(const struct mbin_mont_64 *, uint64_t, uint64_t);
+void	mbin_mont_power_array_64(const struct mbin_mont_64 *, const uint64_t *, uint64_t *, uint64_t, size_t);
+uint64_t mbin_mont_inv_64(const struct mbin_mont_64 *, uint64_t);
+
+/*
+ * Montgomery multiplication for odd moduli, "a * b / 2**32 mod n".
+ * The product "a * b" must be less than "n * 2**32".
+ */
+static inline uint32_t
+mbin_mont_mul_32(const struct mbin_mont_32 *pm, uint32_t a, uint32_t b)
+{
+	const uint64_t t = (uint64_t)a * (uint64_t)b;
+	const uint32_t u = (uint32_t)t * -pm->ninv;
+	const uint32_t h = ((uint64_t)u * (uint64_t)pm->n) >> 32;
+	const uint32_t r = t >> 32;
+
+	/* the low halves are equal, so the difference is exact */
+	return (r - h + ((r < h) ? pm->n : 0));
+}
+
+static inline uint32_t
+mbin_mont_to_32(const struct mbin_mont_32 *pm, uint32_t a)
+{
+	return (mbin_mont_mul_32(pm, a % pm->n, pm->r2));
+}
+
+static inline uint32_t
+mbin_mont_from_32(const struct mbin_mont_32 *pm, uint32_t a)
+{
+	return (mbin_mont_mul_32(pm, a, 1));
+}
+
+#define	MBIN_FACTOR_MAX_64 64
+
+uint32_t mbin_factor_all_64(uint64_t x, uint64_t *pfact);
+void	mbin_factor_array_64(const uint64_t *, uint64_t *, uint32_t *, size_t);
+void	mbin_factor_array_mt_64(const uint64_t *, uint64_t *, uint32_t *, size_t, uint32_t);
 
 uint32_t mbin_parse32_abc(const char *ptr, const char *end);
 void	mbin_parse32_add(const char *ptr, uint32_t *ptable, uint32_t mask);
@@ -433,6 +548,23 @@ uint32_t mbin_div7_32(uint32_t r, uint32_t d);
 uint32_t mbin_rebase_722_32(uint32_t x);
 uint32_t mbin_rebase_227_32(uint32_t x);
 
+/* Table driven base-N conversion */
+
+struct mbin_rebase {
+	uint16_t to2[1024];
+	uint16_t from2[1024];
+	struct mbin_baseN chunk;
+	uint8_t	base;
+	uint8_t	bits;
+	uint8_t	digits;
+};
+
+void	mbin_rebase_init(struct mbin_rebase *, uint8_t base);
+uint32_t mbin_rebase_N22_32(const struct mbin_rebase *, uint32_t);
+uint32_t mbin_rebase_22N_32(const struct mbin_rebase *, uint32_t);
+uint64_t mbin_rebase_N22_64(const struct mbin_rebase *, uint64_t);
+uint64_t mbin_rebase_22N_64(const struct mbin_rebase *, uint64_t);
+
 /* Base-2/3 */
 
 struct mbin_base23_state32 {
@@ -510,6 +642,12 @@ void	mbin_expr_free_xor(struct mbin_expr *pexpr, struct mbin_expr_xor *pxor);
 void	mbin_expr_free(struct mbin_expr *pexpr);
 void	mbin_expr_optimise(struct mbin_expr *pexpr, uint32_t mask);
 
+typedef const uint64_t *(mbin_expr_var_fn_t)(int8_t type, int8_t subtype, void *arg);
+
+void	mbin_expr_eval_sliced(struct mbin_expr *pexpr, mbin_expr_var_fn_t *fn, void *arg, uint64_t *out, size_t nwords);
+void	mbin_expr_slice_32(const uint32_t *src, uint64_t *dst, size_t nwords);
+void	mbin_expr_unslice_32(const uint64_t *src, uint32_t *dst, size_t nwords);
+
 int32_t	mbin_correlate_32x32(uint32_t *pa, uint32_t *pb, uint32_t mask, uint32_t slice_a, uint32_t slice_b);
 
 uint32_t mbin_sos_32(int32_t x, int32_t y);
@@ -585,6 +723,20 @@ extern void mbin_eq_print_func_32(mbin_eq_head_32_t *, const uint32_t);
 extern void mbin_eq_print_code_32(mbin_eq_head_32_t *, const uint32_t, const char *);
 extern uint32_t mbin_eq_func_32(mbin_eq_head_32_t *, const uint32_t, const uint32_t, const uint32_t);
 
+struct mbin_eq_code_32 {
+	uint32_t size;
+	uint32_t count;
+	uint32_t *mask_a;
+	uint32_t *mask_b;
+	uint32_t *value;
+};
+
+extern struct mbin_eq_code_32 *mbin_eq_compile_32(mbin_eq_head_32_t *, const uint32_t);
+extern void mbin_eq_code_free_32(struct mbin_eq_code_32 *);
+extern uint32_t mbin_eq_code_func_32(const struct mbin_eq_code_32 *, const uint32_t, const uint32_t);
+extern void mbin_eq_code_func_array_32(const struct mbin_eq_code_32 *, const uint32_t *, const uint32_t *, uint32_t *, size_t);
+extern void mbin_eq_code_table_32(const struct mbin_eq_code_32 *, uint32_t *);
+
 /* Equation float prototypes */
 
 struct mbin_eq_f32;
@@ -643,6 +795,9 @@ typedef struct mbin_complex_quad_double {
 void	mbin_xor2_multi_xform_32(uint32_t *ptr, const uint32_t *fact);
 void	mbin_xor3_multi_xform_32(uint32_t *ptr, const uint32_t *fact);
 void	mbin_add_inv_multi_xform_32(uint32_t *ptr, const uint32_t *fact);
+void	mbin_xor2_multi_xform_mt_32(uint32_t *ptr, const uint32_t *fact, uint32_t nthreads);
+void	mbin_xor3_multi_xform_mt_32(uint32_t *ptr, const uint32_t *fact, uint32_t nthreads);
+void	mbin_add_inv_multi_xform_mt_32(uint32_t *ptr, const uint32_t *fact, uint32_t nthreads);
 void	mbin_add_mod_inv_multi_xform_32(uint32_t *ptr, const uint32_t *fact);
 void	mbin_xor_mod_inv_multi_xform_32(uint32_t *ptr, const uint32_t *fact);
 
@@ -650,6 +805,12 @@ void	mbin_xform3_fwd_double(double *ptr, const uint32_t max);
 void	mbin_xform3_inv_double(double *ptr, const uint32_t max);
 void	mbin_xform3_alt_fwd_double(double *ptr, const size_t wmax);
 void	mbin_xform3_alt_inv_double(double *ptr, const size_t wmax);
+void	mbin_xform3_fwd_mt_double(double *ptr, const uint32_t max, uint32_t nthreads);
+void	mbin_xform3_inv_mt_double(double *ptr, const uint32_t max, uint32_t nthreads);
+void	mbin_xform3_alt_fwd_mt_double(double *ptr, const size_t wmax, uint32_t nthreads);
+void	mbin_xform3_alt_inv_mt_double(double *ptr, const size_t wmax, uint32_t nthreads);
+void	mbin_digitrev3_32(uint32_t *, uint8_t);
+void	mbin_digitrev3_double(double *, uint8_t);
 
 void	mbin_multiply_xform_32(const uint32_t *, const uint32_t *, uint32_t *, uint8_t);
 void	mbin_multiply_xform_64(const uint64_t *, const uint64_t *, uint64_t *, uint8_t);
@@ -682,6 +843,10 @@ void	mbin_inverse_r3_add_xform_32(uint32_t *, uint8_t);
 void	mbin_forward_r3_add_xform_32(uint32_t *, uint8_t);
 void	mbin_inverse_r3_xor2_xform_32(uint32_t *, uint8_t);
 void	mbin_forward_r3_xor2_xform_32(uint32_t *, uint8_t);
+void	mbin_inverse_r3_add_xform_mt_32(uint32_t *, uint8_t, uint32_t);
+void	mbin_forward_r3_add_xform_mt_32(uint32_t *, uint8_t, uint32_t);
+void	mbin_inverse_r3_xor2_xform_mt_32(uint32_t *, uint8_t, uint32_t);
+void	mbin_forward_r3_xor2_xform_mt_32(uint32_t *, uint8_t, uint32_t);
 void	mbin_xor3_mod_inverse_add_xform_64(uint64_t *, uint64_t, uint64_t, uint8_t);
 void	mbin_xor3_mod_forward_add_xform_64(uint64_t *, uint64_t, uint64_t, uint8_t);
 void	mbin_xor3_inverse_add_xform_64(uint64_t *, uint8_t);
@@ -693,6 +858,9 @@ void	mbin_inverse_add_xform_complex_double(struct mbin_complex_double *, uint8_t
 void	mbin_forward_add_xform_complex_double(struct mbin_complex_double *, uint8_t);
 void	mbin_xor_xform_32(uint32_t *, uint8_t);
 void	mbin_xor_xform_64(uint64_t *, uint8_t);
+void	mbin_xor_xform_mt_32(uint32_t *, uint8_t, uint32_t);
+void	mbin_inverse_add_xform_mt_32(uint32_t *, uint8_t, uint32_t);
+void	mbin_forward_add_xform_mt_32(uint32_t *, uint8_t, uint32_t);
 void	mbin_xor_xform_print_32(const uint32_t *, uint8_t);
 void	mbin_xor_xform_print_simple_32(const uint32_t *, uint8_t);
 void	mbin_xor_xform_8(uint8_t *, uint8_t);
@@ -718,6 +886,14 @@ void	mbin_vector_and_double(double *, double *, double *, uint8_t);
 void	mbin_vector_and_32(uint32_t *, uint32_t *, uint32_t *, uint8_t);
 void	mbin_vector_xor_double(double *, double *, double *, uint8_t);
 void	mbin_vector_xor_32(uint32_t *, uint32_t *, uint32_t *, uint8_t);
+void	mbin_vector_or_apply_double(const double *, const double *, double *, uint8_t);
+void	mbin_vector_or_apply_32(const uint32_t *, const uint32_t *, uint32_t *, uint8_t);
+void	mbin_vector_and_apply_double(const double *, const double *, double *, uint8_t);
+void	mbin_vector_and_apply_32(const uint32_t *, const uint32_t *, uint32_t *, uint8_t);
+void	mbin_vector_xor_apply_double(const double *, const double *, double *, uint8_t);
+void	mbin_vector_xor_apply_32(const uint32_t *, const uint32_t *, uint32_t *, uint8_t);
+void	mbin_vector_subset_double(const double *, const double *, double *, uint8_t);
+void	mbin_vector_subset_32(const uint32_t *, const uint32_t *, uint32_t *, uint8_t);
 
 /* Noise functions */
 
@@ -755,6 +931,7 @@ void mbin_sub_conj_complex_quad_double(const struct mbin_complex_quad_double *,
 /* Orthogonal functions */
 
 void	mbin_find_orthogonal_key_32(const uint32_t *, uint32_t, uint32_t, uint32_t **);
+void	mbin_find_orthogonal_key_mt_32(const uint32_t *, uint32_t, uint32_t, uint32_t **, uint32_t);
 
 /* Multiplication functions */
 
@@ -782,6 +959,24 @@ void	mbin_put_bits32(uint32_t *ptr, uint32_t *poff, uint32_t bits, uint32_t valu
 uint32_t mbin_get_rev_bits32(const uint32_t *ptr, uint32_t *poff, uint32_t bits);
 void	mbin_put_rev_bits32(uint32_t *ptr, uint32_t *poff, uint32_t bits, uint32_t value);
 
+struct mbin_bitstream {
+	uint32_t *wptr;
+	const uint32_t *rptr;
+	uint64_t acc;
+	size_t	index;
+	uint8_t	fill;
+};
+
+void	mbin_bitstream_init_write(struct mbin_bitstream *, uint32_t *);
+void	mbin_bitstream_init_read(struct mbin_bitstream *, const uint32_t *);
+void	mbin_bitstream_put_32(struct mbin_bitstream *, uint32_t bits, uint32_t value);
+void	mbin_bitstream_flush(struct mbin_bitstream *);
+uint32_t mbin_bitstream_get_32(struct mbin_bitstream *, uint32_t bits);
+uint64_t mbin_bitstream_read_offset(const struct mbin_bitstream *);
+uint64_t mbin_bitstream_write_offset(const struct mbin_bitstream *);
+void	mbin_pack_bits32(const uint32_t *, uint32_t *, size_t num, uint8_t bits);
+void	mbin_unpack_bits32(const uint32_t *, uint32_t *, size_t num, uint8_t bits);
+
 /* XOR functions */
 
 struct mbin_poly_32 {
@@ -852,6 +1047,9 @@ uint64_t mbin_xor2_faculty_64(uint64_t);
 uint64_t mbin_xor2_coeff_64(int64_t, int64_t);
 uint64_t mbin_xor2_gcd_64(uint64_t, uint64_t);
 void	mbin_xor2_gcd_extended_64(uint64_t, uint64_t, uint64_t *, uint64_t *);
+void	mbin_xor2_gcd_array_64(const uint64_t *, const uint64_t *, uint64_t *, size_t);
+uint32_t mbin_xor2_factor_all_64(uint64_t, uint64_t *);
+uint8_t	mbin_xor2_is_irreducible_64(uint64_t);
 void	mbin_xor2_generate_plain_64(uint8_t, uint64_t *, uint64_t *);
 
 void	mbin_xor_print_mat_32(const uint32_t *, uint32_t, uint8_t);
@@ -864,6 +1062,8 @@ uint64_t mbin_xor3_mul_mod_any_64(uint64_t, uint64_t, uint64_t);
 uint32_t mbin_xor3_mul_mod_any_32(uint32_t, uint32_t, uint32_t);
 uint64_t mbin_xor3_mul_64(uint64_t, uint64_t);
 uint64_t mbin_xor3_factor_slow_64(uint64_t);
+uint32_t mbin_xor3_factor_all_64(uint64_t, uint64_t *);
+uint8_t	mbin_xor3_is_irreducible_64(uint64_t);
 uint64_t mbin_xor3_exp_mod_64(uint64_t, uint64_t, uint8_t, uint8_t);
 uint64_t mbin_xor3_exp_mod_any_64(uint64_t, uint64_t, uint64_t);
 uint64_t mbin_xor3_exp_slow_mod_any_64(uint64_t, uint64_t, uint64_t);
@@ -917,16 +1117,41 @@ void	mbin_moda_create_32(uint32_t *, const uint32_t);
 void	mbin_lina_by_moda_slow_32(uint32_t *, const uint32_t *, const uint32_t);
 void	mbin_mod_table_create(const uint32_t *, uint32_t *, const uint32_t);
 void	mbin_lina_by_moda_lookup_32(uint32_t *, const uint32_t *, const uint32_t *, const uint32_t);
+void	mbin_mod_garner_create(const uint32_t *, uint32_t *, const uint32_t);
+void	mbin_lina_by_moda_garner_32(uint32_t *, const uint32_t *, const uint32_t *, const uint32_t);
 void	mbin_moda_by_lina_slow_32(uint32_t *, const uint32_t *, const uint32_t);
 void	mbin_moda_add_32(const uint32_t *, const uint32_t *, uint32_t *, const uint32_t *, const uint32_t);
 void	mbin_moda_sub_32(const uint32_t *, const uint32_t *, uint32_t *, const uint32_t *, const uint32_t);
 void	mbin_moda_mul_32(const uint32_t *, const uint32_t *, uint32_t *, const uint32_t *, const uint32_t);
 void	mbin_moda_div_32(const uint32_t *, const uint32_t *, uint32_t *, const uint32_t *, const uint32_t);
 void	mbin_moda_power_32(const uint32_t *, uint32_t *, const uint32_t *, const uint32_t, const uint32_t);
+int	mbin_jacobi_32(uint32_t, uint32_t);
 uint8_t	mbin_mod_is_square_32(const uint32_t, const uint32_t);
+uint8_t	mbin_mod_sqrt_32(const uint32_t, const uint32_t, uint32_t *);
 uint8_t	mbin_moda_is_square_32(const uint32_t *, const uint32_t *, const uint32_t);
+uint8_t	mbin_moda_sqrt_32(const uint32_t *, uint32_t *, const uint32_t *, const uint32_t);
 uint32_t mbin_leading_by_lina_32(const uint32_t *, const uint32_t *, const uint32_t);
 void	mbin_lina_by_leading_32(uint32_t, uint32_t *, const uint32_t *, const uint32_t);
+uint32_t mbin_leading_by_lina_limb_32(const uint32_t *, const uint32_t *, const uint32_t, uint32_t *, const uint32_t);
+uint8_t	mbin_lina_by_leading_limb_32(uint32_t *, uint32_t, uint32_t *, const uint32_t *, const uint32_t);
+
+/* Residue number system prototypes */
+struct mbin_rns_32 {
+	uint32_t *mod;
+	struct mbin_mont_32 *mont;
+	uint32_t *table;
+	uint32_t *garner;
+	uint32_t n;
+};
+
+struct mbin_rns_32 *mbin_rns_alloc_32(const uint32_t *, const uint32_t);
+void	mbin_rns_free_32(struct mbin_rns_32 *);
+void	mbin_rns_add_32(const struct mbin_rns_32 *, const uint32_t *, const uint32_t *, uint32_t *, const size_t);
+void	mbin_rns_sub_32(const struct mbin_rns_32 *, const uint32_t *, const uint32_t *, uint32_t *, const size_t);
+void	mbin_rns_mul_32(const struct mbin_rns_32 *, const uint32_t *, const uint32_t *, uint32_t *, const size_t);
+void	mbin_rns_div_32(const struct mbin_rns_32 *, const uint32_t *, const uint32_t *, uint32_t *, const size_t);
+void	mbin_rns_power_32(const struct mbin_rns_32 *, const uint32_t *, uint32_t *, const uint32_t, const size_t);
+void	mbin_rns_lina_32(const struct mbin_rns_32 *, uint32_t *, const size_t);
 
 /* XOR2 mod array prototypes */
 void	mbin_xor2_moda_create_32(uint32_t *, const uint32_t, const uint32_t);
@@ -1023,6 +1248,17 @@ typedef struct {
 void mbin_hpt_xform_fwd_double(hpt_double_t *, uint8_t);
 void mbin_hpt_xform_inv_double(hpt_double_t *, uint8_t);
 
+struct mbin_hpt_plan_double {
+	hpt_double_t *fwd;
+	hpt_double_t *inv;
+	uint8_t	power;
+};
+
+struct mbin_hpt_plan_double *mbin_hpt_plan_alloc_double(uint8_t);
+void mbin_hpt_plan_free_double(struct mbin_hpt_plan_double *);
+void mbin_hpt_plan_fwd_double(const struct mbin_hpt_plan_double *, hpt_double_t *);
+void mbin_hpt_plan_inv_double(const struct mbin_hpt_plan_double *, hpt_double_t *);
+
 /* Sine-wave functions */
 
 #define	MBIN_PI 0.5f
@@ -1104,6 +1340,20 @@ void mbin_fpx_multiply_8(const uint8_t *, const uint8_t *, uint8_t *, uint8_t);
 
 void mbin_eq_mod_gen_32(int32_t *, size_t, uint64_t *, uint64_t *);
 void mbin_eq_mod_solve_32(void *, int32_t *, size_t);
+
+struct mbin_eq_mod_32 {
+	int32_t *table;			/* [max][2 * max] */
+	int32_t *pmod;			/* modulus of every column */
+	int32_t *pinv;			/* inverse tables */
+	double *prcp;			/* reciprocal of every column modulus */
+	size_t *poff;			/* inverse table offsets */
+	size_t	max;
+};
+
+struct mbin_eq_mod_32 *mbin_eq_mod_alloc_32(const int32_t *, size_t);
+void mbin_eq_mod_free_32(struct mbin_eq_mod_32 *);
+void mbin_eq_mod_solve_ctx_32(struct mbin_eq_mod_32 *, uint32_t);
+
 void mbin_eq_mod_flip_32(void *, size_t);
 void mbin_eq_mod_print_32(const void *, int32_t *, size_t, bool);
 void mbin_eq_mod_decompose_32(int32_t *, int32_t *, size_t);
@@ -1115,6 +1365,12 @@ uint32_t mbin_lucas_step_count_mod_32(uint32_t);
 uint32_t mbin_lucas_step_length_squared_mod_32(uint32_t);
 uint32_t mbin_lucas_pi_squared_mod_32(uint32_t);
 
+/* Thread helpers */
+
+typedef void (mbin_thread_fn_t)(void *, uint32_t, uint32_t);
+
+void mbin_thread_run(mbin_thread_fn_t *, void *, uint32_t);
+
 /* Modular FFT */
 
 void mbin_mod_fft_fwd_32(int32_t *, const int32_t *table, uint8_t log2_size, bool doBitreverse);
@@ -27,6 +27,7 @@
  * baseM implements a standard integer multiplier
  */
 
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -38,13 +39,9 @@ mbin_baseM_next_32(uint32_t a1, uint32_t a0, uint32_t xor, uint32_t pol)
 	return (xor ^ a1 ^ (2 * ((a1 ^ a0) & (pol ^ a0))));
 }
 
-/*
- * Number base conversion from base2 to baseM.
- */
-uint32_t
-mbin_base_2toM_32(uint32_t b2, uint32_t xor, uint32_t pol)
+static inline uint32_t
+mbin_base_2toM_sub_32(uint32_t b2, uint32_t f, uint32_t pol)
 {
-	uint32_t f = mbin_grayB_inv32(xor);
 	uint32_t r = 0;
 	uint32_t x;
 
@@ -61,13 +58,9 @@ mbin_base_2toM_32(uint32_t b2, uint32_t xor, uint32_t pol)
 	return (r);
 }
 
-/*
- * Number base conversion from baseM to base2.
- */
-uint32_t
-mbin_base_Mto2_32(uint32_t bm, uint32_t xor, uint32_t pol)
+static inline uint32_t
+mbin_base_Mto2_sub_32(uint32_t bm, uint32_t f, uint32_t pol)
 {
-	uint32_t f = mbin_grayB_inv32(xor);
 	uint32_t b2 = 0;
 	uint32_t r = 0;
 	uint32_t x;
@@ -89,6 +82,24 @@ mbin_base_Mto2_32(uint32_t bm, uint32_t xor, uint32_t pol)
 	return (b2);
 }
 
+/*
+ * Number base conversion from base2 to baseM.
+ */
+uint32_t
+mbin_base_2toM_32(uint32_t b2, uint32_t xor, uint32_t pol)
+{
+	return (mbin_base_2toM_sub_32(b2, mbin_grayB_inv32(xor), pol));
+}
+
+/*
+ * Number base conversion from baseM to base2.
+ */
+uint32_t
+mbin_base_Mto2_32(uint32_t bm, uint32_t xor, uint32_t pol)
+{
+	return (mbin_base_Mto2_sub_32(bm, mbin_grayB_inv32(xor), pol));
+}
+
 /*
  * The following function will restore the state variables at index
  * "x" using the given "xor" and "pol":
@@ -255,3 +266,29 @@ mbin_baseM_bits_step_alt_32(struct mbin_baseM_bits32 *st)
 	key = c ^ d;
 	altkey = c - d
 */
+
+/*
+ * Array versions of the baseM conversions, computing the factor
+ * only once.
+ */
+void
+mbin_base_2toM_array_32(const uint32_t *src, uint32_t *dst, size_t num,
+    uint32_t xor, uint32_t pol)
+{
+	const uint32_t f = mbin_grayB_inv32(xor);
+	size_t n;
+
+	for (n = 0; n != num; n++)
+		dst[n] = mbin_base_2toM_sub_32(src[n], f, pol);
+}
+
+void
+mbin_base_Mto2_array_32(const uint32_t *src, uint32_t *dst, size_t num,
+    uint32_t xor, uint32_t pol)
+{
+	const uint32_t f = mbin_grayB_inv32(xor);
+	size_t n;
+
+	for (n = 0; n != num; n++)
+		dst[n] = mbin_base_Mto2_sub_32(src[n], f, pol);
+}
@@ -23,45 +23,74 @@
  * SUCH DAMAGE.
  */
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "math_bin.h"
 
-struct mbin_base {
-	uint32_t stepmask;
-	uint8_t	stepshift;
-	uint8_t	maxshift;
-};
+#define	MBIN_BASEN_BLOCK 64	/* values per block */
 
-static void
-mbin_get_base(struct mbin_base *mb, uint32_t n)
+/*
+ * Compute the digit layout of base "n", which must be two or greater,
+ * and a reciprocal so that division by "n" can be done using a
+ * multiplication and shifts only.
+ */
+void
+mbin_baseN_init_32(struct mbin_baseN *mb, uint32_t n)
 {
 	uint32_t msb;
+	uint8_t l;
 
 	msb = mbin_msb32((2 * n) - 1);
 
+	mb->n = n;
 	mb->stepmask = msb - 1;
 	mb->stepshift = 0;
 	while (msb >>= 1) {
 		mb->stepshift++;
 	}
 	mb->maxshift = 32 - (32 % mb->stepshift);
-	return;
+
+	for (l = 0; (1ULL << l) < n; l++)
+		;
+	mb->divshift = l;
+	mb->mul = (uint32_t)((((1ULL << l) - n) << 32) / n) + 1;
+}
+
+static uint32_t
+mbin_add_baseN_sub_32(const struct mbin_baseN *mb, uint32_t a, uint32_t b, uint32_t f)
+{
+	uint32_t q;
+	uint32_t r;
+	uint32_t t;
+	uint8_t s;
+
+	r = 0;
+	t = 0;
+
+	for (s = 0; s != mb->maxshift; s += mb->stepshift) {
+		r = r + ((a >> s) & mb->stepmask) +
+		    (((b >> s) & mb->stepmask) * f);
+		q = mbin_baseN_div_32(mb, r);
+		t |= (r - (q * mb->n)) << s;
+		r = q;
+	}
+	return (t);
 }
 
 uint32_t
 mbin_mul_baseN_32(uint32_t a, uint32_t b, uint32_t n)
 {
-	struct mbin_base mb;
+	struct mbin_baseN mb;
 	uint32_t z;
 	uint8_t s;
 
-	mbin_get_base(&mb, n);
+	mbin_baseN_init_32(&mb, n);
 
 	z = 0;
 	for (s = 0; s != mb.maxshift; s += mb.stepshift) {
-		z = mbin_add_baseN_32(z, b << s,
-		    ((a >> s) & mb.stepmask), n);
+		z = mbin_add_baseN_sub_32(&mb, z, b << s,
+		    ((a >> s) & mb.stepmask));
 	}
 	return (z);
 }
@@ -69,42 +98,22 @@ mbin_mul_baseN_32(uint32_t a, uint32_t b, uint32_t n)
 uint32_t
 mbin_add_baseN_32(uint32_t a, uint32_t b, uint32_t f, uint32_t n)
 {
-	struct mbin_base mb;
-	uint32_t r;
-	uint32_t t;
-	uint8_t s;
+	struct mbin_baseN mb;
 
-	mbin_get_base(&mb, n);
+	mbin_baseN_init_32(&mb, n);
 
-	r = 0;
-	t = 0;
-
-	for (s = 0; s != mb.maxshift; s += mb.stepshift) {
-
-		if (f == 1) {
-			r = r + ((a >> s) & mb.stepmask) +
-			    (((b >> s) & mb.stepmask) * 1);
-		} else {
-			r = r + ((a >> s) & mb.stepmask) +
-			    (((b >> s) & mb.stepmask) * f);
-		}
-
-		t |= (r % n) << s;
-
-		r /= n;
-	}
-	return (t);
+	return (mbin_add_baseN_sub_32(&mb, a, b, f));
 }
 
 uint32_t
 mbin_sub_baseN_32(uint32_t a, uint32_t b, uint32_t f, uint32_t n)
 {
-	struct mbin_base mb;
+	struct mbin_baseN mb;
 	uint32_t r;
 	uint32_t t;
 	uint8_t s;
 
-	mbin_get_base(&mb, n);
+	mbin_baseN_init_32(&mb, n);
 	r = 1;
 	t = 0;
 
@@ -124,11 +133,11 @@ mbin_sub_baseN_32(uint32_t a, uint32_t b, uint32_t f, uint32_t n)
 uint32_t
 mbin_sumdigits_baseN_32(uint32_t a, uint32_t n)
 {
-	struct mbin_base mb;
+	struct mbin_baseN mb;
 	uint32_t z;
 	uint8_t s;
 
-	mbin_get_base(&mb, n);
+	mbin_baseN_init_32(&mb, n);
 
 	z = 0;
 	for (s = 0; s != mb.maxshift; s += mb.stepshift) {
@@ -140,11 +149,11 @@ mbin_sumdigits_baseN_32(uint32_t a, uint32_t n)
 uint32_t
 mbin_convert_2toN_32(uint32_t a, uint32_t n)
 {
-	struct mbin_base mb;
+	struct mbin_baseN mb;
 	uint32_t z;
 	uint8_t s;
 
-	mbin_get_base(&mb, n);
+	mbin_baseN_init_32(&mb, n);
 
 	z = 0;
 
@@ -158,12 +167,12 @@ mbin_convert_2toN_32(uint32_t a, uint32_t n)
 uint32_t
 mbin_convert_Nto2_32(uint32_t a, uint32_t n)
 {
-	struct mbin_base mb;
+	struct mbin_baseN mb;
 	uint32_t z;
 	uint32_t f;
 	uint8_t s;
 
-	mbin_get_base(&mb, n);
+	mbin_baseN_init_32(&mb, n);
 
 	z = 0;
 	f = 1;
@@ -174,3 +183,128 @@ mbin_convert_Nto2_32(uint32_t a, uint32_t n)
 	}
 	return (z);
 }
+
+/*
+ * The array functions below convert blocks of values digit by
+ * digit, so that the inner loops run across independent values and
+ * can be vectorised by the compiler.
+ */
+void
+mbin_convert_2toN_array_32(const struct mbin_baseN *mb,
+    const uint32_t *src, uint32_t *dst, size_t num)
+{
+	uint32_t a[MBIN_BASEN_BLOCK];
+	uint32_t z[MBIN_BASEN_BLOCK];
+	uint32_t q;
+	size_t cnt;
+	size_t x;
+	uint8_t s;
+
+	while (num != 0) {
+		cnt = (num > MBIN_BASEN_BLOCK) ? MBIN_BASEN_BLOCK : num;
+
+		for (x = 0; x != cnt; x++) {
+			a[x] = src[x];
+			z[x] = 0;
+		}
+		for (s = 0; s != mb->maxshift; s += mb->stepshift) {
+			for (x = 0; x != cnt; x++) {
+				q = mbin_baseN_div_32(mb, a[x]);
+				z[x] |= (a[x] - (q * mb->n)) << s;
+				a[x] = q;
+			}
+		}
+		for (x = 0; x != cnt; x++)
+			dst[x] = z[x];
+
+		src += cnt;
+		dst += cnt;
+		num -= cnt;
+	}
+}
+
+void
+mbin_convert_Nto2_array_32(const struct mbin_baseN *mb,
+    const uint32_t *src, uint32_t *dst, size_t num)
+{
+	uint32_t z[MBIN_BASEN_BLOCK];
+	uint32_t f;
+	size_t cnt;
+	size_t x;
+	uint8_t s;
+
+	while (num != 0) {
+		cnt = (num > MBIN_BASEN_BLOCK) ? MBIN_BASEN_BLOCK : num;
+
+		for (x = 0; x != cnt; x++)
+			z[x] = 0;
+
+		f = 1;
+		for (s = 0; s != mb->maxshift; s += mb->stepshift) {
+			for (x = 0; x != cnt; x++)
+				z[x] += f * ((src[x] >> s) & mb->stepmask);
+			f *= mb->n;
+		}
+		for (x = 0; x != cnt; x++)
+			dst[x] = z[x];
+
+		src += cnt;
+		dst += cnt;
+		num -= cnt;
+	}
+}
+
+void
+mbin_add_baseN_array_32(const struct mbin_baseN *mb, const uint32_t *pa,
+    const uint32_t *pb, uint32_t *dst, uint32_t f, size_t num)
+{
+	uint32_t r[MBIN_BASEN_BLOCK];
+	uint32_t t[MBIN_BASEN_BLOCK];
+	uint32_t q;
+	size_t cnt;
+	size_t x;
+	uint8_t s;
+
+	while (num != 0) {
+		cnt = (num > MBIN_BASEN_BLOCK) ? MBIN_BASEN_BLOCK : num;
+
+		for (x = 0; x != cnt; x++) {
+			r[x] = 0;
+			t[x] = 0;
+		}
+		for (s = 0; s != mb->maxshift; s += mb->stepshift) {
+			for (x = 0; x != cnt; x++) {
+				r[x] = r[x] + ((pa[x] >> s) & mb->stepmask) +
+				    (((pb[x] >> s) & mb->stepmask) * f);
+				q = mbin_baseN_div_32(mb, r[x]);
+				t[x] |= (r[x] - (q * mb->n)) << s;
+				r[x] = q;
+			}
+		}
+		for (x = 0; x != cnt; x++)
+			dst[x] = t[x];
+
+		pa += cnt;
+		pb += cnt;
+		dst += cnt;
+		num -= cnt;
+	}
+}
+
+void
+mbin_mul_baseN_array_32(const struct mbin_baseN *mb, const uint32_t *pa,
+    const uint32_t *pb, uint32_t *dst, size_t num)
+{
+	size_t x;
+
+	for (x = 0; x != num; x++) {
+		uint32_t z = 0;
+		uint8_t s;
+
+		for (s = 0; s != mb->maxshift; s += mb->stepshift) {
+			z = mbin_add_baseN_sub_32(mb, z, pb[x] << s,
+			    ((pa[x] >> s) & mb->stepmask));
+		}
+		dst[x] = z;
+	}
+}
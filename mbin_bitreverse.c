@@ -23,7 +23,9 @@
  * SUCH DAMAGE.
  */
 
+#include <stddef.h>
 #include <stdint.h>
+#include <sys/endian.h>
 
 #include "math_bin.h"
 
@@ -35,10 +37,8 @@ mbin_bitrev64(uint64_t a)
 	a = ((a & 0x5555555555555555ULL) << 1) | ((a & 0xAAAAAAAAAAAAAAAAULL) >> 1);
 	a = ((a & 0x3333333333333333ULL) << 2) | ((a & 0xCCCCCCCCCCCCCCCCULL) >> 2);
 	a = ((a & 0x0F0F0F0F0F0F0F0FULL) << 4) | ((a & 0xF0F0F0F0F0F0F0F0ULL) >> 4);
-	a = ((a & 0x00FF00FF00FF00FFULL) << 8) | ((a & 0xFF00FF00FF00FF00ULL) >> 8);
-	a = ((a & 0x0000FFFF0000FFFFULL) << 16) | ((a & 0xFFFF0000FFFF0000ULL) >> 16);
-	a = ((a & 0x00000000FFFFFFFFULL) << 32) | ((a & 0xFFFFFFFF00000000ULL) >> 32);
-	return (a);
+	/* reversing the bytes is a single instruction on most CPUs */
+	return (bswap64(a));
 }
 
 uint32_t
@@ -47,9 +47,7 @@ mbin_bitrev32(uint32_t a)
 	a = ((a & 0x55555555) << 1) | ((a & 0xAAAAAAAA) >> 1);
 	a = ((a & 0x33333333) << 2) | ((a & 0xCCCCCCCC) >> 2);
 	a = ((a & 0x0F0F0F0F) << 4) | ((a & 0xF0F0F0F0) >> 4);
-	a = ((a & 0x00FF00FF) << 8) | ((a & 0xFF00FF00) >> 8);
-	a = ((a & 0x0000FFFF) << 16) | ((a & 0xFFFF0000) >> 16);
-	return (a);
+	return (bswap32(a));
 }
 
 uint16_t
@@ -58,8 +56,7 @@ mbin_bitrev16(uint16_t a)
 	a = ((a & 0x5555) << 1) | ((a & 0xAAAA) >> 1);
 	a = ((a & 0x3333) << 2) | ((a & 0xCCCC) >> 2);
 	a = ((a & 0x0F0F) << 4) | ((a & 0xF0F0) >> 4);
-	a = ((a & 0x00FF) << 8) | ((a & 0xFF00) >> 8);
-	return (a);
+	return (bswap16(a));
 }
 
 uint8_t
@@ -70,3 +67,21 @@ mbin_bitrev8(uint8_t a)
 	a = ((a & 0x0F) << 4) | ((a & 0xF0) >> 4);
 	return (a);
 }
+
+void
+mbin_bitrev_array_64(const uint64_t *src, uint64_t *dst, size_t num)
+{
+	size_t x;
+
+	for (x = 0; x != num; x++)
+		dst[x] = mbin_bitrev64(src[x]);
+}
+
+void
+mbin_bitrev_array_32(const uint32_t *src, uint32_t *dst, size_t num)
+{
+	size_t x;
+
+	for (x = 0; x != num; x++)
+		dst[x] = mbin_bitrev32(src[x]);
+}
@@ -23,6 +23,7 @@
  * SUCH DAMAGE.
  */
 
+#include <stddef.h>
 #include <stdint.h>
 #include <sys/endian.h>
 
@@ -132,3 +133,238 @@ mbin_put_rev_bits32(uint32_t *ptr, uint32_t *poff, uint32_t bits,
 
 	*poff = offset;
 }
+
+/*
+ * Buffered bit stream, using the same bit layout as
+ * mbin_put_bits32() and mbin_get_bits32(). Bits are collected in a
+ * 64-bit accumulator and only whole 32-bit words are transferred to
+ * and from the buffer. A stream is used either for writing or for
+ * reading, not both.
+ */
+void
+mbin_bitstream_init_write(struct mbin_bitstream *pbs, uint32_t *ptr)
+{
+	pbs->wptr = ptr;
+	pbs->rptr = NULL;
+	pbs->acc = 0;
+	pbs->index = 0;
+	pbs->fill = 0;
+}
+
+void
+mbin_bitstream_init_read(struct mbin_bitstream *pbs, const uint32_t *ptr)
+{
+	pbs->wptr = NULL;
+	pbs->rptr = ptr;
+	pbs->acc = 0;
+	pbs->index = 0;
+	pbs->fill = 0;
+}
+
+void
+mbin_bitstream_put_32(struct mbin_bitstream *pbs, uint32_t bits, uint32_t value)
+{
+	if (bits < 32)
+		value &= (1U << bits) - 1;
+
+	pbs->acc |= (uint64_t)value << pbs->fill;
+	pbs->fill += bits;
+
+	if (pbs->fill >= 32) {
+		pbs->wptr[pbs->index++] = htole32((uint32_t)pbs->acc);
+		pbs->acc >>= 32;
+		pbs->fill -= 32;
+	}
+}
+
+/*
+ * Write out the bits of a partially filled word. Writing may
+ * continue afterwards.
+ */
+void
+mbin_bitstream_flush(struct mbin_bitstream *pbs)
+{
+	if (pbs->fill != 0)
+		pbs->wptr[pbs->index] = htole32((uint32_t)pbs->acc);
+}
+
+uint32_t
+mbin_bitstream_get_32(struct mbin_bitstream *pbs, uint32_t bits)
+{
+	uint32_t tmp;
+
+	if (pbs->fill < bits) {
+		pbs->acc |= (uint64_t)le32toh(pbs->rptr[pbs->index++]) << pbs->fill;
+		pbs->fill += 32;
+	}
+
+	tmp = (uint32_t)pbs->acc;
+	if (bits < 32)
+		tmp &= (1U << bits) - 1;
+
+	pbs->acc >>= bits;
+	pbs->fill -= bits;
+
+	return (tmp);
+}
+
+/*
+ * Returns the number of bits consumed by a reading stream.
+ */
+uint64_t
+mbin_bitstream_read_offset(const struct mbin_bitstream *pbs)
+{
+	return ((32 * (uint64_t)pbs->index) - pbs->fill);
+}
+
+/*
+ * Returns the number of bits stored by a writing stream.
+ */
+uint64_t
+mbin_bitstream_write_offset(const struct mbin_bitstream *pbs)
+{
+	return ((32 * (uint64_t)pbs->index) + pbs->fill);
+}
+
+/*
+ * Pack or unpack 32 values of a fixed width, which is exactly
+ * "bits" words. The width is a constant in every instance, so the
+ * loops are fully unrolled and all shifts are constants.
+ */
+static __always_inline void
+mbin_pack_block_32(const uint32_t *src, uint32_t *dst, const uint8_t bits)
+{
+	const uint32_t mask = (bits == 32) ? -1U : (1U << bits) - 1;
+	uint64_t acc = 0;
+	uint8_t fill = 0;
+	uint8_t x;
+
+	for (x = 0; x != 32; x++) {
+		acc |= (uint64_t)(src[x] & mask) << fill;
+		fill += bits;
+		if (fill >= 32) {
+			*dst++ = htole32((uint32_t)acc);
+			acc >>= 32;
+			fill -= 32;
+		}
+	}
+}
+
+static __always_inline void
+mbin_unpack_block_32(const uint32_t *src, uint32_t *dst, const uint8_t bits)
+{
+	const uint32_t mask = (bits == 32) ? -1U : (1U << bits) - 1;
+	uint64_t acc = 0;
+	uint8_t fill = 0;
+	uint8_t x;
+
+	for (x = 0; x != 32; x++) {
+		if (fill < bits) {
+			acc |= (uint64_t)le32toh(*src++) << fill;
+			fill += 32;
+		}
+		dst[x] = (uint32_t)acc & mask;
+		acc >>= bits;
+		fill -= bits;
+	}
+}
+
+/*
+ * Pack or unpack all whole blocks of 32 values. Each width gets its
+ * own instance of the loop, so the switch is only evaluated once per
+ * call.
+ */
+#define	MBIN_BITS_SWITCH(fn, src, dst, num, bits) \
+	switch (bits) { \
+	case 1: fn(src, dst, num, 1); break; \
+	case 2: fn(src, dst, num, 2); break; \
+	case 3: fn(src, dst, num, 3); break; \
+	case 4: fn(src, dst, num, 4); break; \
+	case 5: fn(src, dst, num, 5); break; \
+	case 6: fn(src, dst, num, 6); break; \
+	case 7: fn(src, dst, num, 7); break; \
+	case 8: fn(src, dst, num, 8); break; \
+	case 9: fn(src, dst, num, 9); break; \
+	case 10: fn(src, dst, num, 10); break; \
+	case 11: fn(src, dst, num, 11); break; \
+	case 12: fn(src, dst, num, 12); break; \
+	case 13: fn(src, dst, num, 13); break; \
+	case 14: fn(src, dst, num, 14); break; \
+	case 15: fn(src, dst, num, 15); break; \
+	case 16: fn(src, dst, num, 16); break; \
+	case 17: fn(src, dst, num, 17); break; \
+	case 18: fn(src, dst, num, 18); break; \
+	case 19: fn(src, dst, num, 19); break; \
+	case 20: fn(src, dst, num, 20); break; \
+	case 21: fn(src, dst, num, 21); break; \
+	case 22: fn(src, dst, num, 22); break; \
+	case 23: fn(src, dst, num, 23); break; \
+	case 24: fn(src, dst, num, 24); break; \
+	case 25: fn(src, dst, num, 25); break; \
+	case 26: fn(src, dst, num, 26); break; \
+	case 27: fn(src, dst, num, 27); break; \
+	case 28: fn(src, dst, num, 28); break; \
+	case 29: fn(src, dst, num, 29); break; \
+	case 30: fn(src, dst, num, 30); break; \
+	case 31: fn(src, dst, num, 31); break; \
+	case 32: fn(src, dst, num, 32); break; \
+	default: return; \
+	}
+
+static __always_inline void
+mbin_pack_blocks_32(const uint32_t *src, uint32_t *dst, size_t num,
+    const uint8_t bits)
+{
+	for (; num >= 32; num -= 32, src += 32, dst += bits)
+		mbin_pack_block_32(src, dst, bits);
+}
+
+static __always_inline void
+mbin_unpack_blocks_32(const uint32_t *src, uint32_t *dst, size_t num,
+    const uint8_t bits)
+{
+	for (; num >= 32; num -= 32, src += bits, dst += 32)
+		mbin_unpack_block_32(src, dst, bits);
+}
+
+/*
+ * Pack "num" values of "bits" width, 1 to 32, into "dst", which
+ * receives (num * bits + 31) / 32 words.
+ */
+void
+mbin_pack_bits32(const uint32_t *src, uint32_t *dst, size_t num, uint8_t bits)
+{
+	struct mbin_bitstream bs;
+	size_t blocks = num & ~(size_t)31;
+
+	MBIN_BITS_SWITCH(mbin_pack_blocks_32, src, dst, num, bits);
+
+	src += blocks;
+	dst += (blocks / 32) * bits;
+	num -= blocks;
+
+	mbin_bitstream_init_write(&bs, dst);
+	while (num--)
+		mbin_bitstream_put_32(&bs, bits, *src++);
+	mbin_bitstream_flush(&bs);
+}
+
+/*
+ * Unpack "num" values of "bits" width, 1 to 32, from "src".
+ */
+void
+mbin_unpack_bits32(const uint32_t *src, uint32_t *dst, size_t num, uint8_t bits)
+{
+	struct mbin_bitstream bs;
+	size_t blocks = num & ~(size_t)31;
+
+	MBIN_BITS_SWITCH(mbin_unpack_blocks_32, src, dst, num, bits);
+
+	src += (blocks / 32) * bits;
+	dst += blocks;
+	num -= blocks;
+
+	mbin_bitstream_init_read(&bs, src);
+	while (num--)
+		*dst++ = mbin_bitstream_get_32(&bs, bits);
+}
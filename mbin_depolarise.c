@@ -23,6 +23,7 @@
  * SUCH DAMAGE.
  */
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "math_bin.h"
@@ -133,3 +134,13 @@ mbin_depolar_div8(uint8_t rem, uint8_t div)
 	}
 	return (rem ^ s);
 }
+
+void
+mbin_depolarise_array_32(const uint32_t *src, uint32_t *dst, size_t num,
+    uint32_t neg_pol)
+{
+	size_t x;
+
+	for (x = 0; x != num; x++)
+		dst[x] = (src[x] ^ neg_pol) - neg_pol;
+}
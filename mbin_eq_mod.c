@@ -29,6 +29,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 #include "math_bin.h"
 
@@ -42,6 +43,18 @@ mbin_eq_mod_is_valid(int32_t *pmod, size_t num)
 	return (true);
 }
 
+/* multiplicative inverse modulo the prime "mod" */
+static int32_t
+mbin_eq_mod_inv_32(int32_t v, int32_t mod)
+{
+	struct mbin_mont_32 m;
+
+	if ((mod & 1) == 0)
+		return (mbin_power_mod_32(v, mod - 2, mod));
+	mbin_mont_init_32(&m, mod);
+	return (mbin_mont_inv_32(&m, v));
+}
+
 void
 mbin_eq_mod_gen_32(int32_t *pmod, size_t num, uint64_t *pmax, uint64_t *psum)
 {
@@ -98,7 +111,7 @@ mbin_eq_mod_solve_32(void *ptr, int32_t *pmod, size_t max)
 				temp += pmod[y];
 
 			/* compute multiplicative inverse */
-			temp = mbin_power_mod_32(temp, pmod[y] - 2, pmod[y]);
+			temp = mbin_eq_mod_inv_32(temp, pmod[y]);
 
 			if (temp != 1) {
 				/* normalize equation */
@@ -121,6 +134,194 @@ mbin_eq_mod_solve_32(void *ptr, int32_t *pmod, size_t max)
 	}
 }
 
+/*
+ * Context based version of mbin_eq_mod_solve_32(). The table is
+ * allocated together with the context and has the same layout. Every
+ * column modulus is stored separately, avoiding a division per element
+ * to find it, and its reciprocal replaces the division. The inverses
+ * of all residues are precomputed for moduli up to MBIN_EQ_MOD_INV_MAX.
+ * Products are computed in 64 bits and the
+ * results are bit identical to mbin_eq_mod_solve_32() where that does
+ * not overflow. Each value is reduced after every update, because it
+ * may later become a multiplier with its own signed representative.
+ * The table does not need to be reduced on input. It is reduced once
+ * before the elimination, so that every product stays below the
+ * product of two moduli, where the reciprocal gives an exact quotient.
+ */
+#define	MBIN_EQ_MOD_INV_MAX 65536
+#define	MBIN_EQ_MOD_MT_MIN 16384
+
+/* same result as "v % m", using a precomputed reciprocal of "m" */
+static inline int32_t
+mbin_eq_mod_rem_32(int64_t v, int32_t m, double rcp)
+{
+	int64_t r = v - (int64_t)((double)v * rcp) * m;
+
+	if (v >= 0) {
+		if (r < 0)
+			r += m;
+		else if (r >= m)
+			r -= m;
+	} else {
+		if (r > 0)
+			r -= m;
+		else if (r <= -m)
+			r += m;
+	}
+	return (r);
+}
+
+struct mbin_eq_mod_32 *
+mbin_eq_mod_alloc_32(const int32_t *pmod, size_t max)
+{
+	struct mbin_eq_mod_32 *ctx;
+	size_t ninv = 0;
+	size_t off;
+
+	for (size_t x = 0; x != max; x++) {
+		if (pmod[x] <= MBIN_EQ_MOD_INV_MAX)
+			ninv += pmod[x];
+	}
+
+	ctx = malloc(sizeof(*ctx) + 2 * max * sizeof(double) + max * sizeof(size_t) +
+	    (2 * max * max + 2 * max + ninv) * sizeof(int32_t));
+	if (ctx == NULL)
+		return (NULL);
+
+	ctx->max = max;
+	ctx->prcp = (double *)(ctx + 1);
+	ctx->poff = (size_t *)(ctx->prcp + 2 * max);
+	ctx->table = (int32_t *)(ctx->poff + max);
+	ctx->pmod = ctx->table + 2 * max * max;
+	ctx->pinv = ctx->pmod + 2 * max;
+
+	for (size_t x = 0; x != 2 * max * max; x++)
+		ctx->table[x] = 0;
+
+	for (size_t x = 0; x != 2 * max; x++) {
+		ctx->pmod[x] = pmod[x % max];
+		ctx->prcp[x] = 1.0 / pmod[x % max];
+	}
+
+	for (size_t x = off = 0; x != max; x++) {
+		if (pmod[x] > MBIN_EQ_MOD_INV_MAX) {
+			ctx->poff[x] = SIZE_MAX;
+			continue;
+		}
+		ctx->poff[x] = off;
+		for (int32_t y = 0; y != pmod[x]; y++)
+			ctx->pinv[off + y] = y;
+		if (pmod[x] & 1) {
+			struct mbin_mont_32 m;
+
+			/* all the inverses share the same exponent */
+			mbin_mont_init_32(&m, pmod[x]);
+			mbin_mont_power_array_32(&m, (uint32_t *)(ctx->pinv + off),
+			    (uint32_t *)(ctx->pinv + off), pmod[x] - 2, pmod[x]);
+		} else {
+			for (int32_t y = 0; y != pmod[x]; y++)
+				ctx->pinv[off + y] = mbin_eq_mod_inv_32(y, pmod[x]);
+		}
+		off += pmod[x];
+	}
+	return (ctx);
+}
+
+void
+mbin_eq_mod_free_32(struct mbin_eq_mod_32 *ctx)
+{
+	free(ctx);
+}
+
+struct mbin_eq_mod_mt_32 {
+	struct mbin_eq_mod_32 *ctx;
+	size_t x;
+	size_t y;
+};
+
+static void
+mbin_eq_mod_eliminate_32(void *arg, uint32_t index, uint32_t num)
+{
+	struct mbin_eq_mod_mt_32 *pmt = arg;
+	const size_t max = pmt->ctx->max;
+	const size_t cols = 2 * max;
+	const int32_t *pmod = pmt->ctx->pmod;
+	const double *prcp = pmt->ctx->prcp;
+	const int32_t *prow = pmt->ctx->table + pmt->x * cols;
+	const size_t zs = (max * index) / num;
+	const size_t ze = (max * (index + 1)) / num;
+
+	for (size_t z = zs; z != ze; z++) {
+		int32_t *pz = pmt->ctx->table + z * cols;
+		int64_t temp;
+
+		if (z == pmt->x || pz[pmt->y] == 0)
+			continue;
+
+		temp = pz[pmt->y];
+		for (size_t t = 0; t != cols; t++)
+			pz[t] = mbin_eq_mod_rem_32(pz[t] - prow[t] * temp, pmod[t], prcp[t]);
+	}
+}
+
+void
+mbin_eq_mod_solve_ctx_32(struct mbin_eq_mod_32 *ctx, uint32_t nthreads)
+{
+	struct mbin_eq_mod_mt_32 mt = { .ctx = ctx };
+	const size_t max = ctx->max;
+	const size_t cols = 2 * max;
+	const int32_t *pmod = ctx->pmod;
+	uint32_t num;
+	int64_t temp;
+
+	num = nthreads;
+	if (num > (max * cols) / MBIN_EQ_MOD_MT_MIN)
+		num = (max * cols) / MBIN_EQ_MOD_MT_MIN;
+	if (num < 1)
+		num = 1;
+
+	/* reduce the input, keeping the sign like the "%" operator */
+	for (size_t x = 0; x != max; x++) {
+		int32_t *px = ctx->table + x * cols;
+
+		for (size_t z = 0; z != cols; z++)
+			px[z] %= pmod[z];
+	}
+
+	for (size_t x = 0; x != max; x++) {
+		int32_t *px = ctx->table + x * cols;
+
+		for (size_t y = 0; y != max; y++) {
+			if (px[y] == 0)
+				continue;
+			/* get absolute modulus */
+			temp = px[y];
+			if (temp < 0)
+				temp += pmod[y];
+
+			/* look up multiplicative inverse */
+			if (ctx->poff[y] != SIZE_MAX)
+				temp = ctx->pinv[ctx->poff[y] + temp];
+			else
+				temp = mbin_eq_mod_inv_32(temp, pmod[y]);
+
+			if (temp != 1) {
+				/* normalize equation */
+				for (size_t z = 0; z != cols; z++)
+					px[z] = mbin_eq_mod_rem_32(px[z] * temp, pmod[z], ctx->prcp[z]);
+			}
+
+			mt.x = x;
+			mt.y = y;
+			if (num == 1)
+				mbin_eq_mod_eliminate_32(&mt, 0, 1);
+			else
+				mbin_thread_run(&mbin_eq_mod_eliminate_32, &mt, num);
+			break;
+		}
+	}
+}
+
 void
 mbin_eq_mod_flip_32(void *ptr, size_t max)
 {
@@ -165,8 +366,7 @@ mbin_eq_mod_decompose_32(int32_t *ptr, int32_t *pmod, size_t max)
 		for (size_t y = x + 1; y != max; y++) {
 			ptr[y] -= ptr[x];
 			ptr[y] %= pmod[y];
-			ptr[y] *= (int32_t)mbin_power_mod_32(
-			    pmod[x], pmod[y] - 2, pmod[y]);
+			ptr[y] *= mbin_eq_mod_inv_32(pmod[x], pmod[y]);
 			ptr[y] %= pmod[y];
 		}
 	}
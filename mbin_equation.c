@@ -29,6 +29,7 @@
 #include <sysexits.h>
 #include <string.h>
 #include <err.h>
+#include <assert.h>
 
 #include "math_bin.h"
 
@@ -593,3 +594,116 @@ mbin_eq_func_32(mbin_eq_head_32_t *phead, const uint32_t size,
 	}
 	return (r & (size - 1));
 }
+
+struct mbin_eq_code_32 *
+mbin_eq_compile_32(mbin_eq_head_32_t *phead, const uint32_t size)
+{
+	struct mbin_eq_code_32 *pcode;
+	struct mbin_eq_32 *ptr;
+	uint32_t c;
+
+	c = 0;
+	TAILQ_FOREACH(ptr, phead, entry) {
+		if (ptr->value & (size - 1))
+			c++;
+	}
+
+	pcode = malloc(sizeof(*pcode) + (3 * c * sizeof(uint32_t)));
+	if (pcode == NULL)
+		errx(EX_SOFTWARE, "Out of memory");
+
+	pcode->size = size;
+	pcode->count = c;
+	pcode->mask_a = (uint32_t *)(pcode + 1);
+	pcode->mask_b = pcode->mask_a + c;
+	pcode->value = pcode->mask_b + c;
+
+	/* flatten the list, skipping terms which don't contribute */
+	c = 0;
+	TAILQ_FOREACH(ptr, phead, entry) {
+		if ((ptr->value & (size - 1)) == 0)
+			continue;
+		pcode->mask_a[c] = *(uint32_t *)ptr->bitdata % size;
+		pcode->mask_b[c] = *(uint32_t *)ptr->bitdata / size;
+		pcode->value[c] = ptr->value & (size - 1);
+		c++;
+	}
+	return (pcode);
+}
+
+void
+mbin_eq_code_free_32(struct mbin_eq_code_32 *pcode)
+{
+	free(pcode);
+}
+
+uint32_t
+mbin_eq_code_func_32(const struct mbin_eq_code_32 *pcode,
+    const uint32_t a, const uint32_t b)
+{
+	uint32_t x, t, u, r;
+
+	r = 0;
+	for (x = 0; x != pcode->count; x++) {
+		t = pcode->mask_a[x];
+		u = pcode->mask_b[x];
+		r ^= pcode->value[x] &
+		    -(uint32_t)(((a & t) == t) & ((b & u) == u));
+	}
+	return (r);
+}
+
+void
+mbin_eq_code_func_array_32(const struct mbin_eq_code_32 *pcode,
+    const uint32_t *pa, const uint32_t *pb, uint32_t *pr, size_t num)
+{
+	uint32_t x, t, u, v;
+	size_t y, z, max;
+
+	/*
+	 * Evaluate the inputs in blocks of 64, so that each term is
+	 * loaded once per block and the inner loop is branch free.
+	 */
+	for (y = 0; y < num; y += 64) {
+		max = num - y;
+		if (max > 64)
+			max = 64;
+		for (z = 0; z != max; z++)
+			pr[y + z] = 0;
+		for (x = 0; x != pcode->count; x++) {
+			t = pcode->mask_a[x];
+			u = pcode->mask_b[x];
+			v = pcode->value[x];
+			for (z = 0; z != max; z++) {
+				pr[y + z] ^= v & -(uint32_t)(
+				    ((pa[y + z] & t) == t) &
+				    ((pb[y + z] & u) == u));
+			}
+		}
+	}
+}
+
+/*
+ * Compute the full function table, table[a + (b * size)], for all
+ * "a" and "b" less than "size". The "size" argument must be a power
+ * of two and not greater than 32768, so that the table index fits
+ * in 32 bits. Because the variable index is simply "a" and "b"
+ * concatenated, the table is the XOR subset transform of the term
+ * coefficients, which runs in O(N * log2(N)) sequential passes.
+ */
+void
+mbin_eq_code_table_32(const struct mbin_eq_code_32 *pcode, uint32_t *table)
+{
+	const uint8_t log2_max = 2 * mbin_sumbits32(pcode->size - 1);
+	uint32_t x;
+
+	assert(pcode->size <= 32768);
+
+	memset(table, 0, sizeof(table[0]) << log2_max);
+
+	for (x = 0; x != pcode->count; x++) {
+		table[pcode->mask_a[x] + (pcode->mask_b[x] *
+		    pcode->size)] ^= pcode->value[x];
+	}
+	mbin_xor_xform_32(table, log2_max);
+}
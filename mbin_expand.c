@@ -91,12 +91,21 @@ mbin_expand_add_32x32(uint32_t *ptr, uint32_t set_bits,
     uint32_t mask, uint32_t val)
 {
 	uint32_t x;
+	uint32_t y;
+	uint32_t run;
 
 	set_bits |= (~mask);
 	x = set_bits;
 
+	/* the bits below "run" are free and give a contiguous range */
+	run = mbin_lsb32(set_bits);
+	if (run == 0)
+		run = 1U << 31;
+
 	while (1) {
-		ptr[x & mask] -= val;
+		for (y = 0; y != run; y++)
+			ptr[(x & mask) + y] -= val;
+		x |= run - 1;
 
 		if (x == (uint32_t)(0 - 1)) {
 			break;
@@ -111,12 +120,21 @@ mbin_expand_add_mod_32x32(uint32_t *ptr, uint32_t set_bits,
     uint32_t mask, uint32_t val, uint32_t mod)
 {
 	uint32_t x;
+	uint32_t y;
+	uint32_t run;
 
 	set_bits |= (~mask);
 	x = set_bits;
 
+	/* the bits below "run" are free and give a contiguous range */
+	run = mbin_lsb32(set_bits);
+	if (run == 0)
+		run = 1U << 31;
+
 	while (1) {
-		ptr[x & mask] = (mod + ptr[x & mask] - val) % mod;
+		for (y = 0; y != run; y++)
+			ptr[(x & mask) + y] = (mod + ptr[(x & mask) + y] - val) % mod;
+		x |= run - 1;
 
 		if (x == (uint32_t)(0 - 1)) {
 			break;
@@ -131,12 +149,21 @@ mbin_expand_xor_32x32(uint32_t *ptr, uint32_t set_bits,
     uint32_t mask, uint32_t slice)
 {
 	uint32_t x;
+	uint32_t y;
+	uint32_t run;
 
 	set_bits |= (~mask);
 	x = set_bits;
 
+	/* the bits below "run" are free and give a contiguous range */
+	run = mbin_lsb32(set_bits);
+	if (run == 0)
+		run = 1U << 31;
+
 	while (1) {
-		ptr[x & mask] ^= slice;
+		for (y = 0; y != run; y++)
+			ptr[(x & mask) + y] ^= slice;
+		x |= run - 1;
 		if (x == (uint32_t)(0 - 1)) {
 			break;
 		}
@@ -150,12 +177,21 @@ mbin_expand_xor_16x32(uint16_t *ptr, uint32_t set_bits,
     uint32_t mask, uint16_t slice)
 {
 	uint32_t x;
+	uint32_t y;
+	uint32_t run;
 
 	set_bits |= (~mask);
 	x = set_bits;
 
+	/* the bits below "run" are free and give a contiguous range */
+	run = mbin_lsb32(set_bits);
+	if (run == 0)
+		run = 1U << 31;
+
 	while (1) {
-		ptr[x & mask] ^= slice;
+		for (y = 0; y != run; y++)
+			ptr[(x & mask) + y] ^= slice;
+		x |= run - 1;
 		if (x == (uint32_t)(0 - 1)) {
 			break;
 		}
@@ -169,12 +205,21 @@ mbin_expand_xor_8x32(uint8_t *ptr, uint32_t set_bits,
     uint32_t mask, uint8_t slice)
 {
 	uint32_t x;
+	uint32_t y;
+	uint32_t run;
 
 	set_bits |= (~mask);
 	x = set_bits;
 
+	/* the bits below "run" are free and give a contiguous range */
+	run = mbin_lsb32(set_bits);
+	if (run == 0)
+		run = 1U << 31;
+
 	while (1) {
-		ptr[x & mask] ^= slice;
+		for (y = 0; y != run; y++)
+			ptr[(x & mask) + y] ^= slice;
+		x |= run - 1;
 		if (x == (uint32_t)(0 - 1)) {
 			break;
 		}
@@ -23,6 +23,7 @@
  * SUCH DAMAGE.
  */
 
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 #include <sys/queue.h>
@@ -32,23 +33,65 @@
 
 #include "math_bin.h"
 
+#define	MBIN_EXPR_CHUNK_MIN (1UL << 12)
+#define	MBIN_EXPR_CHUNK_MAX (1UL << 20)
+
+struct mbin_expr_arena;
+
 struct mbin_expr_and {
 	TAILQ_ENTRY(mbin_expr_and) entry;
+	struct mbin_expr_arena *arena;	/* set if allocated from an arena */
 	int8_t	type;
 	int8_t	subtype;
 	int8_t	shift;
-	int8_t	reserved;
 };
 
 struct mbin_expr_xor {
 	TAILQ_ENTRY(mbin_expr_xor) entry;
 	TAILQ_HEAD(, mbin_expr_and) head;
+	struct mbin_expr_arena *arena;	/* set if allocated from an arena */
 	uint32_t value;
 };
 
+/*
+ * All AND and XOR nodes belonging to one expression are carved out
+ * of a few large chunks, which are never moved. Freed nodes are put
+ * on a free list for reuse and the chunks are released all at once
+ * when the expression is freed. Each node records the arena it was
+ * allocated from. A node may be dequeued by the caller or moved to
+ * another expression, but it stays owned by its arena. The arena
+ * counts its nodes which are in use, but not linked into a list of
+ * the same arena, and if the expression is freed before they are
+ * freed, releasing the arena is deferred until the last of them has
+ * been freed.
+ */
+struct mbin_expr_chunk {
+	struct mbin_expr_chunk *next;
+	size_t	size;
+	size_t	used;
+	uint64_t data[0];
+};
+
+struct mbin_expr_arena {
+	struct mbin_expr_chunk *chunk;
+	struct mbin_expr_and *free_and;
+	struct mbin_expr_xor *free_xor;
+	size_t	total;			/* bytes used in all chunks */
+	uint32_t foreign;		/* nodes not from this arena */
+	uint32_t lent;			/* nodes not linked into this arena */
+	uint8_t	freed;			/* expression has been freed */
+};
+
 struct mbin_expr {
 	TAILQ_ENTRY(mbin_expr) entry;
 	TAILQ_HEAD(, mbin_expr_xor) head;
+	struct mbin_expr_arena arena;
+};
+
+struct mbin_expr_reloc {
+	uintptr_t base;
+	size_t	used;
+	char   *ptr;
 };
 
 uint32_t
@@ -102,8 +145,15 @@ mbin_expr_set_shift_and(struct mbin_expr_and *pand, int8_t shift)
 void
 mbin_expr_enqueue_and(struct mbin_expr_xor *pxor, struct mbin_expr_and *pand)
 {
-	if (pand->entry.tqe_prev == NULL)
+	if (pand->entry.tqe_prev == NULL) {
+		if (pand->arena != pxor->arena) {
+			if (pxor->arena != NULL)
+				pxor->arena->foreign++;
+		} else if (pand->arena != NULL) {
+			pand->arena->lent--;
+		}
 		TAILQ_INSERT_TAIL(&pxor->head, pand, entry);
+	}
 }
 
 void
@@ -113,6 +163,8 @@ mbin_expr_dequeue_and(struct mbin_expr_xor *pxor, struct mbin_expr_and *pand)
 		return;
 
 	if (pand->entry.tqe_prev != NULL) {
+		if (pand->arena != NULL && pand->arena == pxor->arena)
+			pand->arena->lent++;
 		TAILQ_REMOVE(&pxor->head, pand, entry);
 		pand->entry.tqe_prev = NULL;
 	}
@@ -132,8 +184,13 @@ mbin_expr_foreach_and(struct mbin_expr_xor *pxor, struct mbin_expr_and *pand)
 void
 mbin_expr_enqueue_xor(struct mbin_expr *pexpr, struct mbin_expr_xor *pxor)
 {
-	if (pxor->entry.tqe_prev == NULL)
+	if (pxor->entry.tqe_prev == NULL) {
+		if (pxor->arena != &pexpr->arena)
+			pexpr->arena.foreign++;
+		else
+			pexpr->arena.lent--;
 		TAILQ_INSERT_TAIL(&pexpr->head, pxor, entry);
+	}
 }
 
 void
@@ -143,6 +200,8 @@ mbin_expr_dequeue_xor(struct mbin_expr *pexpr, struct mbin_expr_xor *pxor)
 		return;
 
 	if (pxor->entry.tqe_prev != NULL) {
+		if (pxor->arena == &pexpr->arena)
+			pexpr->arena.lent++;
 		TAILQ_REMOVE(&pexpr->head, pxor, entry);
 		pxor->entry.tqe_prev = NULL;
 	}
@@ -741,10 +800,97 @@ mbin_expr_print(struct mbin_expr *pexpr)
 	}
 }
 
+static void *
+mbin_expr_arena_alloc(struct mbin_expr_arena *pa, size_t size)
+{
+	struct mbin_expr_chunk *pc;
+	size_t csize;
+	void *ptr;
+
+	size = (size + 7) & ~(size_t)7;
+
+	pc = pa->chunk;
+	if (pc == NULL || (pc->size - pc->used) < size) {
+		csize = (pc == NULL) ? MBIN_EXPR_CHUNK_MIN : (2 * pc->size);
+		if (csize > MBIN_EXPR_CHUNK_MAX)
+			csize = MBIN_EXPR_CHUNK_MAX;
+		if (csize < size)
+			csize = size;
+		pc = malloc(sizeof(*pc) + csize);
+		if (pc == NULL)
+			return (NULL);
+		pc->next = pa->chunk;
+		pc->size = csize;
+		pc->used = 0;
+		pa->chunk = pc;
+	}
+	ptr = (char *)pc->data + pc->used;
+	pc->used += size;
+	pa->total += size;
+	return (ptr);
+}
+
+static struct mbin_expr_and *
+mbin_expr_arena_alloc_and(struct mbin_expr_arena *pa)
+{
+	struct mbin_expr_and *pand;
+
+	pand = pa->free_and;
+	if (pand != NULL)
+		pa->free_and = TAILQ_NEXT(pand, entry);
+	else
+		pand = mbin_expr_arena_alloc(pa, sizeof(*pand));
+	if (pand != NULL)
+		pa->lent++;
+	return (pand);
+}
+
+static struct mbin_expr_xor *
+mbin_expr_arena_alloc_xor(struct mbin_expr_arena *pa)
+{
+	struct mbin_expr_xor *pxor;
+
+	pxor = pa->free_xor;
+	if (pxor != NULL)
+		pa->free_xor = TAILQ_NEXT(pxor, entry);
+	else
+		pxor = mbin_expr_arena_alloc(pa, sizeof(*pxor));
+	if (pxor != NULL)
+		pa->lent++;
+	return (pxor);
+}
+
+static void
+mbin_expr_arena_free(struct mbin_expr_arena *pa)
+{
+	struct mbin_expr_chunk *pc;
+
+	while ((pc = pa->chunk) != NULL) {
+		pa->chunk = pc->next;
+		free(pc);
+	}
+	memset(pa, 0, sizeof(*pa));
+}
+
+/* release an arena whose expression was freed, once nothing uses it */
+static void
+mbin_expr_arena_check(struct mbin_expr_arena *pa)
+{
+	if (pa->freed == 0 || pa->lent != 0)
+		return;
+	mbin_expr_arena_free(pa);
+	free((char *)pa - offsetof(struct mbin_expr, arena));
+}
+
 struct mbin_expr_and *
 mbin_expr_dup_and(struct mbin_expr_and *pand_old, struct mbin_expr_xor *pxor)
 {
-	struct mbin_expr_and *pand = malloc(sizeof(*pand));
+	struct mbin_expr_and *pand;
+
+	if (pxor != NULL && pxor->arena != NULL)
+		pand = mbin_expr_arena_alloc_and(pxor->arena);
+	else
+		pand = malloc(sizeof(*pand));
 
 	if (pand == NULL)
 		return (NULL);
@@ -753,6 +899,8 @@ mbin_expr_dup_and(struct mbin_expr_and *pand_old, struct mbin_expr_xor *pxor)
 
 	memset(&pand->entry, 0, sizeof(pand->entry));
 
+	pand->arena = (pxor != NULL) ? pxor->arena : NULL;
+
 	if (pxor != NULL)
 		mbin_expr_enqueue_and(pxor, pand);
 
@@ -762,13 +910,20 @@ mbin_expr_dup_and(struct mbin_expr_and *pand_old, struct mbin_expr_xor *pxor)
 struct mbin_expr_and *
 mbin_expr_alloc_and(struct mbin_expr_xor *pxor)
 {
-	struct mbin_expr_and *pand = malloc(sizeof(*pand));
+	struct mbin_expr_and *pand;
+
+	if (pxor != NULL && pxor->arena != NULL)
+		pand = mbin_expr_arena_alloc_and(pxor->arena);
+	else
+		pand = malloc(sizeof(*pand));
 
 	if (pand == NULL)
 		return (NULL);
 
 	memset(pand, 0, sizeof(*pand));
 
+	pand->arena = (pxor != NULL) ? pxor->arena : NULL;
+
 	if (pxor != NULL)
 		mbin_expr_enqueue_and(pxor, pand);
 
@@ -778,9 +933,14 @@ mbin_expr_alloc_and(struct mbin_expr_xor *pxor)
 struct mbin_expr_xor *
 mbin_expr_dup_xor(struct mbin_expr_xor *pxor_old, struct mbin_expr *pexpr)
 {
-	struct mbin_expr_xor *pxor = malloc(sizeof(*pxor));
+	struct mbin_expr_xor *pxor;
 	struct mbin_expr_and *pand;
 
+	if (pexpr != NULL)
+		pxor = mbin_expr_arena_alloc_xor(&pexpr->arena);
+	else
+		pxor = malloc(sizeof(*pxor));
+
 	if (pxor == NULL)
 		return (NULL);
 
@@ -790,6 +950,8 @@ mbin_expr_dup_xor(struct mbin_expr_xor *pxor_old, struct mbin_expr *pexpr)
 
 	TAILQ_INIT(&pxor->head);
 
+	pxor->arena = (pexpr != NULL) ? &pexpr->arena : NULL;
+
 	if (pexpr != NULL)
 		mbin_expr_enqueue_xor(pexpr, pxor);
 
@@ -805,7 +967,12 @@ mbin_expr_dup_xor(struct mbin_expr_xor *pxor_old, struct mbin_expr *pexpr)
 struct mbin_expr_xor *
 mbin_expr_alloc_xor(struct mbin_expr *pexpr)
 {
-	struct mbin_expr_xor *pxor = malloc(sizeof(*pxor));
+	struct mbin_expr_xor *pxor;
+
+	if (pexpr != NULL)
+		pxor = mbin_expr_arena_alloc_xor(&pexpr->arena);
+	else
+		pxor = malloc(sizeof(*pxor));
 
 	if (pxor == NULL)
 		return (NULL);
@@ -816,26 +983,144 @@ mbin_expr_alloc_xor(struct mbin_expr *pexpr)
 
 	pxor->value = 0xFFFFFFFFUL;
 
-	if (pexpr != NULL)
+	if (pexpr != NULL) {
+		pxor->arena = &pexpr->arena;
 		mbin_expr_enqueue_xor(pexpr, pxor);
+	}
 
 	return (pxor);
 }
 
-struct mbin_expr *
-mbin_expr_dup(struct mbin_expr *pexpr_old)
+static int
+mbin_expr_reloc_cmp(const void *a, const void *b)
 {
-	struct mbin_expr *pexpr = malloc(sizeof(*pexpr));
+	const struct mbin_expr_reloc *pa = a;
+	const struct mbin_expr_reloc *pb = b;
+
+	return ((pa->base > pb->base) - (pa->base < pb->base));
+}
+
+/* look up the chunk of "ptr" in the table sorted by base address */
+static void *
+mbin_expr_reloc(const struct mbin_expr_reloc *pr, uint32_t num, void *ptr)
+{
+	const uintptr_t p = (uintptr_t)ptr;
+	uint32_t lo = 0;
+	uint32_t hi = num;
+	uint32_t x;
+
+	while (lo != hi) {
+		x = (lo + hi) / 2;
+		if (pr[x].base <= p)
+			lo = x + 1;
+		else
+			hi = x;
+	}
+	if (lo == 0 || p - pr[lo - 1].base >= pr[lo - 1].used)
+		return (ptr);
+	return (pr[lo - 1].ptr + (p - pr[lo - 1].base));
+}
+
+/*
+ * Duplicate an expression which only has nodes from its own arena,
+ * by copying all the chunks into one and relocating the pointers.
+ */
+static struct mbin_expr *
+mbin_expr_dup_arena(struct mbin_expr *pexpr_old)
+{
+	struct mbin_expr *pexpr;
+	struct mbin_expr_chunk *pc;
 	struct mbin_expr_xor *pxor;
+	struct mbin_expr_and *pand;
+	uint32_t num;
+	size_t off;
 
+	num = 0;
+	for (pc = pexpr_old->arena.chunk; pc != NULL; pc = pc->next)
+		num++;
+	if (num == 0)
+		return (mbin_expr_alloc());
+
+	struct mbin_expr_reloc reloc[num];
+
+	pexpr = mbin_expr_alloc();
 	if (pexpr == NULL)
 		return (NULL);
 
-	*pexpr = *pexpr_old;
+	pc = malloc(sizeof(*pc) + pexpr_old->arena.total);
+	if (pc == NULL) {
+		mbin_expr_free(pexpr);
+		return (NULL);
+	}
+	pc->next = NULL;
+	pc->size = pexpr_old->arena.total;
+	pc->used = pexpr_old->arena.total;
+	pexpr->arena.chunk = pc;
+	pexpr->arena.total = pc->used;
+
+	num = 0;
+	off = 0;
+	for (pc = pexpr_old->arena.chunk; pc != NULL; pc = pc->next) {
+		reloc[num].base = (uintptr_t)pc->data;
+		reloc[num].used = pc->used;
+		reloc[num].ptr = (char *)pexpr->arena.chunk->data + off;
+		memcpy(reloc[num].ptr, pc->data, pc->used);
+		off += pc->used;
+		num++;
+	}
+	qsort(reloc, num, sizeof(reloc[0]), &mbin_expr_reloc_cmp);
+
+	/* relocate all list pointers */
+	if (TAILQ_EMPTY(&pexpr_old->head))
+		return (pexpr);
+
+	pexpr->head.tqh_first = mbin_expr_reloc(reloc, num, pexpr_old->head.tqh_first);
+	pexpr->head.tqh_last = mbin_expr_reloc(reloc, num, pexpr_old->head.tqh_last);
+	pexpr->head.tqh_first->entry.tqe_prev = &pexpr->head.tqh_first;
+
+	TAILQ_FOREACH(pxor, &pexpr->head, entry) {
+		pxor->arena = &pexpr->arena;
+		pxor->entry.tqe_next = mbin_expr_reloc(reloc, num, pxor->entry.tqe_next);
+		if (pxor != TAILQ_FIRST(&pexpr->head))
+			pxor->entry.tqe_prev = mbin_expr_reloc(reloc, num, pxor->entry.tqe_prev);
+		pxor->head.tqh_first = mbin_expr_reloc(reloc, num, pxor->head.tqh_first);
+		pxor->head.tqh_last = mbin_expr_reloc(reloc, num, pxor->head.tqh_last);
+
+		TAILQ_FOREACH(pand, &pxor->head, entry) {
+			pand->arena = &pexpr->arena;
+			pand->entry.tqe_next = mbin_expr_reloc(reloc, num, pand->entry.tqe_next);
+			pand->entry.tqe_prev = mbin_expr_reloc(reloc, num, pand->entry.tqe_prev);
+		}
+	}
 
-	memset(&pexpr->entry, 0, sizeof(pexpr->entry));
+	/* relocate the free lists */
+	pexpr->arena.free_and = mbin_expr_reloc(reloc, num, pexpr_old->arena.free_and);
+	for (pand = pexpr->arena.free_and; pand != NULL; pand = pand->entry.tqe_next) {
+		pand->arena = &pexpr->arena;
+		pand->entry.tqe_next = mbin_expr_reloc(reloc, num, pand->entry.tqe_next);
+	}
 
-	TAILQ_INIT(&pexpr->head);
+	pexpr->arena.free_xor = mbin_expr_reloc(reloc, num, pexpr_old->arena.free_xor);
+	for (pxor = pexpr->arena.free_xor; pxor != NULL; pxor = pxor->entry.tqe_next) {
+		pxor->arena = &pexpr->arena;
+		pxor->entry.tqe_next = mbin_expr_reloc(reloc, num, pxor->entry.tqe_next);
+	}
+
+	return (pexpr);
+}
+
+struct mbin_expr *
+mbin_expr_dup(struct mbin_expr *pexpr_old)
+{
+	struct mbin_expr *pexpr;
+	struct mbin_expr_xor *pxor;
+
+	if (pexpr_old->arena.foreign == 0)
+		return (mbin_expr_dup_arena(pexpr_old));
+
+	pexpr = mbin_expr_alloc();
+	if (pexpr == NULL)
+		return (NULL);
 
 	TAILQ_FOREACH(pxor, &pexpr_old->head, entry) {
 		if (mbin_expr_dup_xor(pxor, pexpr) == NULL) {
@@ -865,7 +1150,17 @@ void
 mbin_expr_free_and(struct mbin_expr_xor *pxor, struct mbin_expr_and *pand)
 {
 	mbin_expr_dequeue_and(pxor, pand);
-	free(pand);
+
+	/* only the owning arena can reuse the node */
+	if (pand->arena == NULL) {
+		free(pand);
+	} else {
+		pand->entry.tqe_next = pand->arena->free_and;
+		pand->arena->free_and = pand;
+		pand->arena->lent--;
+		if (pxor == NULL || pand->arena != pxor->arena)
+			mbin_expr_arena_check(pand->arena);
+	}
 }
 
 void
@@ -878,7 +1173,14 @@ mbin_expr_free_xor(struct mbin_expr *pexpr, struct mbin_expr_xor *pxor)
 	while ((pand = TAILQ_FIRST(&pxor->head)))
 		mbin_expr_free_and(pxor, pand);
 
-	free(pxor);
+	if (pxor->arena == NULL) {
+		free(pxor);
+	} else {
+		pxor->entry.tqe_next = pxor->arena->free_xor;
+		pxor->arena->free_xor = pxor;
+		pxor->arena->lent--;
+		mbin_expr_arena_check(pxor->arena);
+	}
 }
 
 void
@@ -886,124 +1188,314 @@ mbin_expr_free(struct mbin_expr *pexpr)
 {
 	struct mbin_expr_xor *pxor;
 
-	while ((pxor = TAILQ_FIRST(&pexpr->head)))
-		mbin_expr_free_xor(pexpr, pxor);
+	/* free nodes which were not allocated from the arena, if any */
+	if (pexpr->arena.foreign != 0) {
+		while ((pxor = TAILQ_FIRST(&pexpr->head)))
+			mbin_expr_free_xor(pexpr, pxor);
+	}
+	/* nodes held elsewhere keep the arena alive */
+	pexpr->arena.freed = 1;
+	mbin_expr_arena_check(&pexpr->arena);
+}
+
+/*
+ * Clear the value bits which are shifted out by the AND
+ * expressions and return the number of AND expressions.
+ */
+static uint32_t
+mbin_expr_mask_xor(struct mbin_expr_xor *pxa)
+{
+	struct mbin_expr_and *paa;
+	uint32_t alen;
+
+	alen = 0;
 
-	free(pexpr);
+	paa = NULL;
+	while ((paa = mbin_expr_foreach_and(pxa, paa))) {
+		if (paa->shift > 0) {
+			if (paa->shift > 31) {
+				pxa->value = 0;
+			} else {
+				pxa->value >>= paa->shift;
+				pxa->value <<= paa->shift;
+			}
+		} else if (paa->shift < 0) {
+			if (paa->shift < -31) {
+				pxa->value = 0;
+			} else {
+				pxa->value <<= -paa->shift;
+				pxa->value >>= -paa->shift;
+			}
+		}
+		alen++;
+	}
+	return (alen);
 }
 
-static struct mbin_expr_xor *
-mbin_expr_xor_delete(struct mbin_expr *pexpr, struct mbin_expr_xor *pxor)
+struct mbin_expr_term {
+	struct mbin_expr_xor *pxor;
+	uint32_t *key;
+	uint32_t len;
+	uint32_t hash;
+};
+
+static uint32_t
+mbin_expr_key_and(const struct mbin_expr_and *paa)
 {
-	struct mbin_expr_xor *pnext;
+	return (((uint32_t)(uint8_t)paa->type << 16) |
+	    ((uint32_t)(uint8_t)paa->subtype << 8) |
+	    ((uint32_t)(uint8_t)paa->shift));
+}
 
-	/* get next element */
-	pnext = mbin_expr_foreach_xor(pexpr, pxor);
-	mbin_expr_free_xor(pexpr, pxor);
-	return (pnext);
+/*
+ * Build the canonical key of an XOR statement, which is the sorted
+ * list of its unique AND expressions packed as (type, subtype, shift).
+ */
+static uint32_t
+mbin_expr_key_xor(struct mbin_expr_xor *pxa, uint32_t *key)
+{
+	struct mbin_expr_and *paa;
+	uint32_t len;
+	uint32_t x;
+	uint32_t y;
+	uint32_t k;
+
+	len = 0;
+	paa = NULL;
+	while ((paa = mbin_expr_foreach_and(pxa, paa))) {
+		k = mbin_expr_key_and(paa);
+
+		/* insertion sort, AND lists are short */
+		for (x = 0; x != len && key[x] < k; x++)
+			;
+		if (x != len && key[x] == k)
+			continue;
+		for (y = len; y != x; y--)
+			key[y] = key[y - 1];
+		key[x] = k;
+		len++;
+	}
+	return (len);
+}
+
+static uint32_t
+mbin_expr_hash_key(const uint32_t *key, uint32_t len)
+{
+	uint32_t hash = 2166136261U;
+	uint32_t x;
+
+	for (x = 0; x != len; x++) {
+		hash ^= key[x];
+		hash *= 16777619U;
+		hash ^= hash >> 15;
+	}
+	return (hash);
 }
 
 void
 mbin_expr_optimise(struct mbin_expr *pexpr, uint32_t mask)
 {
+	struct mbin_expr_term *pterm;
+	struct mbin_expr_term *pt;
 	struct mbin_expr_xor *pxa;
-	struct mbin_expr_xor *pxb;
-
+	struct mbin_expr_xor *pxn;
 	struct mbin_expr_and *paa;
-	struct mbin_expr_and *pab;
+	uint32_t *keys;
+	uint32_t *table;
+	uint32_t nxor;
+	uint32_t nand;
+	uint32_t hsize;
+	uint32_t x;
+	uint32_t y;
+
+	nxor = nand = 0;
+	pxa = NULL;
+	while ((pxa = mbin_expr_foreach_xor(pexpr, pxa))) {
+		paa = NULL;
+		while ((paa = mbin_expr_foreach_and(pxa, paa)))
+			nand++;
+		nxor++;
+	}
 
-	uint32_t alen;
-	uint32_t blen;
+	if (nxor == 0)
+		return;
 
-	uint8_t found;
+	for (hsize = 1; hsize < (2 * nxor); hsize *= 2)
+		;
 
-	pxa = mbin_expr_foreach_xor(pexpr, NULL);
-	while (pxa) {
+	pterm = malloc(sizeof(pterm[0]) * nxor);
+	keys = malloc(sizeof(keys[0]) * (nand + 1));
+	table = calloc(hsize, sizeof(table[0]));
 
-		/* compute AND expression length */
+	/* the expression is left as is, if out of memory */
+	if (pterm == NULL || keys == NULL || table == NULL) {
+		free(pterm);
+		free(keys);
+		free(table);
+		return;
+	}
 
-		alen = 0;
+	/*
+	 * Merge XOR statements having the same set of AND expressions
+	 * using a hash table. Because "a & a" equals "a", repeated AND
+	 * expressions are ignored, so that for example "a0&a0" merges
+	 * with "a0". The first statement accumulates the values of the
+	 * later ones.
+	 */
+	nxor = nand = 0;
+	pxa = mbin_expr_foreach_xor(pexpr, NULL);
+	while (pxa) {
+		pxn = mbin_expr_foreach_xor(pexpr, pxa);
+
+		pt = pterm + nxor;
+		pt->pxor = pxa;
+		pt->key = keys + nand;
+		pt->len = mbin_expr_key_xor(pxa, pt->key);
+		pt->hash = mbin_expr_hash_key(pt->key, pt->len);
+
+		for (x = pt->hash & (hsize - 1); table[x] != 0;
+		    x = (x + 1) & (hsize - 1)) {
+			y = table[x] - 1;
+			if (pterm[y].hash == pt->hash &&
+			    pterm[y].len == pt->len &&
+			    memcmp(pterm[y].key, pt->key,
+			    sizeof(pt->key[0]) * pt->len) == 0)
+				break;
+		}
 
-		paa = NULL;
-		while ((paa = mbin_expr_foreach_and(pxa, paa))) {
-			if (paa->shift > 0) {
-				if (paa->shift > 31) {
-					pxa->value = 0;
-				} else {
-					pxa->value >>= paa->shift;
-					pxa->value <<= paa->shift;
-				}
-			} else if (paa->shift < 0) {
-				if (paa->shift < -31) {
-					pxa->value = 0;
-				} else {
-					pxa->value <<= -paa->shift;
-					pxa->value >>= -paa->shift;
-				}
+		if (table[x] != 0) {
+			/* accumulate AND expression */
+			pterm[table[x] - 1].pxor->value ^= pxa->value;
+			mbin_expr_free_xor(pexpr, pxa);
+		} else {
+			mbin_expr_mask_xor(pxa);
+
+			/* remove all zero values */
+			if ((pxa->value & mask) == 0) {
+				mbin_expr_free_xor(pexpr, pxa);
+			} else {
+				table[x] = ++nxor;
+				nand += pt->len;
 			}
-			alen++;
 		}
+		pxa = pxn;
+	}
 
-		/* remove all zero values */
+	/* remove all cancelled statements */
+	for (x = 0; x != nxor; x++) {
+		if ((pterm[x].pxor->value & mask) == 0)
+			mbin_expr_free_xor(pexpr, pterm[x].pxor);
+	}
 
-		if ((pxa->value & mask) == 0) {
-			pxa = mbin_expr_xor_delete(pexpr, pxa);
-			continue;
-		}
-		/* look for matching AND expression */
+	free(pterm);
+	free(keys);
+	free(table);
+}
 
-		pxb = pxa;
-		pxb = mbin_expr_foreach_xor(pexpr, pxb);
+/*
+ * Evaluate an expression for (64 * nwords) inputs at the same time.
+ * Values are stored bitsliced, one group of "nwords" words per bit
+ * position, so that word "w" of bit "i" holds bit "i" of the inputs
+ * (64 * w) to (64 * w + 63). The callback returns the bitsliced
+ * input variable for a given type and subtype, or NULL if the
+ * variable is zero. The result is stored in "out", which has room
+ * for (32 * nwords) words.
+ */
+void
+mbin_expr_eval_sliced(struct mbin_expr *pexpr, mbin_expr_var_fn_t *fn,
+    void *arg, uint64_t *out, size_t nwords)
+{
+	struct mbin_expr_xor *pxa;
+	struct mbin_expr_and *paa;
+	uint32_t alen;
+	uint32_t x;
+	uint32_t y;
+	size_t w;
+	int i;
 
-		while (pxb != NULL) {
-			blen = 0;
+	memset(out, 0, sizeof(out[0]) * 32 * nwords);
 
-			pab = NULL;
-			while ((pab = mbin_expr_foreach_and(pxb, pab))) {
-				blen++;
-			}
+	pxa = NULL;
+	while ((pxa = mbin_expr_foreach_xor(pexpr, pxa))) {
+		alen = 0;
+		paa = NULL;
+		while ((paa = mbin_expr_foreach_and(pxa, paa)))
+			alen++;
 
-			if (alen != blen) {
-				pxb = mbin_expr_foreach_xor(pexpr, pxb);
-				continue;
-			}
-			found = 1;
+		const uint64_t *pvar[alen + 1];
+		int8_t shift[alen + 1];
+		uint64_t temp[nwords];
 
-			paa = NULL;
-			while ((paa = mbin_expr_foreach_and(pxa, paa))) {
+		/* resolve all variables once */
+		x = 0;
+		paa = NULL;
+		while ((paa = mbin_expr_foreach_and(pxa, paa))) {
+			pvar[x] = fn(paa->type, paa->subtype, arg);
+			if (pvar[x] == NULL)
+				break;
+			shift[x] = paa->shift;
+			x++;
+		}
+		if (x != alen)
+			continue;
 
-				found = 0;
+		for (i = 0; i != 32; i++) {
+			if (((pxa->value >> i) & 1) == 0)
+				continue;
 
-				pab = NULL;
-				while ((pab = mbin_expr_foreach_and(pxb, pab))) {
+			for (w = 0; w != nwords; w++)
+				temp[w] = -1ULL;
 
-					if ((paa->type == pab->type) &&
-					    (paa->subtype == pab->subtype) &&
-					    (paa->shift == pab->shift)) {
-						found = 1;
-						break;
-					}
-				}
+			for (y = 0; y != alen; y++) {
+				/* bit "i" of (var << shift) */
+				int src = i - shift[y];
 
-				if (!found)
+				if (src < 0 || src > 31)
 					break;
+				for (w = 0; w != nwords; w++)
+					temp[w] &= pvar[y][(src * nwords) + w];
 			}
-
-			if (found) {
-				/* accumulate AND expression */
-				pxa->value ^= pxb->value;
-				pxb = mbin_expr_xor_delete(pexpr, pxb);
+			if (y != alen)
 				continue;
-			}
-			pxb = mbin_expr_foreach_xor(pexpr, pxb);
+
+			for (w = 0; w != nwords; w++)
+				out[(i * nwords) + w] ^= temp[w];
 		}
+	}
+}
 
-		/* check for zero */
+void
+mbin_expr_slice_32(const uint32_t *src, uint64_t *dst, size_t nwords)
+{
+	uint64_t temp;
+	size_t w;
+	uint32_t x;
+	uint32_t y;
+
+	for (x = 0; x != 32; x++) {
+		for (w = 0; w != nwords; w++) {
+			temp = 0;
+			for (y = 0; y != 64; y++)
+				temp |= (uint64_t)((src[(64 * w) + y] >> x) & 1) << y;
+			dst[(x * nwords) + w] = temp;
+		}
+	}
+}
 
-		if ((pxa->value & mask) == 0) {
-			pxa = mbin_expr_xor_delete(pexpr, pxa);
-			continue;
+void
+mbin_expr_unslice_32(const uint64_t *src, uint32_t *dst, size_t nwords)
+{
+	uint32_t temp;
+	size_t w;
+	uint32_t x;
+	uint32_t y;
+
+	for (w = 0; w != nwords; w++) {
+		for (y = 0; y != 64; y++) {
+			temp = 0;
+			for (x = 0; x != 32; x++)
+				temp |= (uint32_t)((src[(x * nwords) + w] >> y) & 1) << x;
+			dst[(64 * w) + y] = temp;
 		}
-		pxa = mbin_expr_foreach_xor(pexpr, pxa);
 	}
 }
@@ -23,6 +23,7 @@
  * SUCH DAMAGE.
  */
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "math_bin.h"
@@ -36,31 +37,29 @@
  * See also: https://en.wikipedia.org/wiki/Gray_code
  */
 
+/*
+ * The inverse is a prefix XOR of the bits, which can be computed in
+ * five steps instead of one step per bit.
+ */
 uint32_t
 mbin_grayA_inv32(uint32_t t)
 {
-	uint32_t m = 0x80000000;
-
-	while (m) {
-		if (t & m) {
-			t ^= (m / 2);
-		}
-		m /= 2;
-	}
+	t ^= t >> 1;
+	t ^= t >> 2;
+	t ^= t >> 4;
+	t ^= t >> 8;
+	t ^= t >> 16;
 	return (t);
 }
 
 uint32_t
 mbin_grayB_inv32(uint32_t t)
 {
-	uint32_t m = 1;
-
-	while (m) {
-		if (t & m) {
-			t ^= (2 * m);
-		}
-		m *= 2;
-	}
+	t ^= t << 1;
+	t ^= t << 2;
+	t ^= t << 4;
+	t ^= t << 8;
+	t ^= t << 16;
 	return (t);
 }
 
@@ -75,3 +74,39 @@ mbin_grayB_fwd32(uint32_t t)
 {
 	return (t ^ (t * 2));
 }
+
+void
+mbin_grayA_inv_array_32(const uint32_t *src, uint32_t *dst, size_t num)
+{
+	size_t x;
+
+	for (x = 0; x != num; x++)
+		dst[x] = mbin_grayA_inv32(src[x]);
+}
+
+void
+mbin_grayA_fwd_array_32(const uint32_t *src, uint32_t *dst, size_t num)
+{
+	size_t x;
+
+	for (x = 0; x != num; x++)
+		dst[x] = mbin_grayA_fwd32(src[x]);
+}
+
+void
+mbin_grayB_inv_array_32(const uint32_t *src, uint32_t *dst, size_t num)
+{
+	size_t x;
+
+	for (x = 0; x != num; x++)
+		dst[x] = mbin_grayB_inv32(src[x]);
+}
+
+void
+mbin_grayB_fwd_array_32(const uint32_t *src, uint32_t *dst, size_t num)
+{
+	size_t x;
+
+	for (x = 0; x != num; x++)
+		dst[x] = mbin_grayB_fwd32(src[x]);
+}
@@ -174,3 +174,129 @@ mbin_hpt_xform_inv_double(hpt_double_t *data, uint8_t power)
 		}
 	}
 }
+
+/*
+ * The transform factors only depend on the power and are the same
+ * for every call. Compute them once into a plan, in the order they
+ * are consumed by the butterflies. The factors are computed exactly
+ * like above, so the planned transforms give identical results.
+ */
+struct mbin_hpt_plan_double *
+mbin_hpt_plan_alloc_double(uint8_t power)
+{
+	const uint32_t max = 1U << power;
+	const hpt_double_t fwd_base = {{0, 1}};
+	const hpt_double_t inv_base = {{1, 0}};
+	struct mbin_hpt_plan_double *plan;
+	hpt_double_t *k;
+	uint32_t step;
+	uint32_t y;
+	uint32_t z;
+	uint32_t u;
+
+	plan = malloc(sizeof(*plan) + 3 * sizeof(hpt_double_t) * max);
+	if (plan == NULL)
+		return (NULL);
+
+	plan->power = power;
+	plan->fwd = (hpt_double_t *)(plan + 1);
+	plan->inv = plan->fwd + 2 * max;
+
+	k = plan->fwd;
+
+	for (step = max; (step /= 2);) {
+		for (y = z = 0; y != max; y += 2 * step) {
+			u = mbin_hpt_add_bitreversed_32(z, step);
+
+			*k++ = mbin_hpt_exp_fwd_double(fwd_base, z);
+			*k++ = mbin_hpt_exp_fwd_double(fwd_base, u);
+
+			z = mbin_hpt_add_bitreversed_32(z, max / 4);
+		}
+	}
+
+	k = plan->inv;
+
+	for (step = 1; step != max; step *= 2) {
+		for (y = z = 0; y != max; y += 2 * step) {
+			*k++ = mbin_hpt_exp_inv_double(inv_base, z);
+			z = mbin_hpt_add_bitreversed_32(z, max / 4);
+		}
+	}
+	return (plan);
+}
+
+void
+mbin_hpt_plan_free_double(struct mbin_hpt_plan_double *plan)
+{
+	free(plan);
+}
+
+/*
+ * The butterflies below operate on both components at the same time
+ * and are written so that the compiler can keep each "hpt_double_t"
+ * in a single two-lane vector register.
+ */
+void
+mbin_hpt_plan_fwd_double(const struct mbin_hpt_plan_double *plan, hpt_double_t *data)
+{
+	const uint32_t max = 1U << plan->power;
+	const hpt_double_t *k = plan->fwd;
+	uint32_t step;
+	uint32_t x;
+	uint32_t y;
+
+	for (step = max; (step /= 2); ) {
+		for (y = 0; y != max; y += 2 * step, k += 2) {
+			const double k00 = k[0].r[0];
+			const double k01 = k[0].r[1];
+			const double k10 = k[1].r[0];
+			const double k11 = k[1].r[1];
+			hpt_double_t *pa = data + y;
+			hpt_double_t *pb = data + y + step;
+
+			for (x = 0; x != step; x++) {
+				const double a0 = pa[x].r[0];
+				const double a1 = pa[x].r[1];
+				const double b0 = pb[x].r[0];
+				const double b1 = pb[x].r[1];
+
+				pa[x].r[0] = a0 + (b0 * k00 - 3.0 * b1 * k01);
+				pa[x].r[1] = a1 + (b0 * k01 + b1 * k00);
+				pb[x].r[0] = a0 + (b0 * k10 - 3.0 * b1 * k11);
+				pb[x].r[1] = a1 + (b0 * k11 + b1 * k10);
+			}
+		}
+	}
+}
+
+void
+mbin_hpt_plan_inv_double(const struct mbin_hpt_plan_double *plan, hpt_double_t *data)
+{
+	const uint32_t max = 1U << plan->power;
+	const hpt_double_t *k = plan->inv;
+	uint32_t step;
+	uint32_t x;
+	uint32_t y;
+
+	for (step = 1; step != max; step *= 2) {
+		for (y = 0; y != max; y += 2 * step, k++) {
+			const double k0 = k[0].r[0];
+			const double k1 = k[0].r[1];
+			hpt_double_t *pa = data + y;
+			hpt_double_t *pb = data + y + step;
+
+			for (x = 0; x != step; x++) {
+				const double s0 = pa[x].r[0] + pb[x].r[0];
+				const double s1 = pa[x].r[1] + pb[x].r[1];
+				const double d0 = pa[x].r[0] - pb[x].r[0];
+				const double d1 = pa[x].r[1] - pb[x].r[1];
+
+				pa[x].r[0] = s0;
+				pa[x].r[1] = s1;
+				pb[x].r[0] = d0 * k1 + d1 * k0;
+				pb[x].r[1] = d1 * k1 - d0 * k0 / 3.0;
+			}
+		}
+	}
+}
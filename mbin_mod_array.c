@@ -23,7 +23,9 @@
  * SUCH DAMAGE.
  */
 
+#include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 #include "math_bin.h"
 
@@ -43,11 +45,11 @@ mbin_moda_create_32(uint32_t *mod, const uint32_t n)
 		/* find valid modulus */
 		do {
 			y += 2;
-			for (z = 3; z != y; z += 2) {
+			for (z = 3; (z * z) <= y; z += 2) {
 				if ((y % z) == 0)
 					break;
 			}
-		} while (z != y);
+		} while ((z * z) <= y);
 	}
 }
 
@@ -55,14 +57,15 @@ mbin_moda_create_32(uint32_t *mod, const uint32_t n)
 void
 mbin_lina_by_moda_slow_32(uint32_t *ptr, const uint32_t *mod, const uint32_t n)
 {
+	struct mbin_mont_32 m;
 	uint32_t x;
 	uint32_t y;
 
 	for (x = 0; x != n; x++) {
 		for (y = x + 1; y != n; y++) {
+			mbin_mont_init_32(&m, mod[y]);
 			ptr[y] = (U64(U64(mod[y]) + U64(ptr[y]) - U64(ptr[x])) *
-			    U64(mbin_power_mod_32(mod[x],
-			    mod[y] - 2, mod[y]))) % U64(mod[y]);
+			    U64(mbin_mont_inv_32(&m, mod[x]))) % U64(mod[y]);
 		}
 	}
 }
@@ -70,13 +73,15 @@ mbin_lina_by_moda_slow_32(uint32_t *ptr, const uint32_t *mod, const uint32_t n)
 void
 mbin_mod_table_create(const uint32_t *mod, uint32_t *table, const uint32_t n)
 {
+	struct mbin_mont_32 m;
 	uint32_t x;
 	uint32_t y;
 	uint32_t z;
 
 	for (z = x = 0; x != n; x++) {
 		for (y = x + 1; y != n; y++) {
-			table[z++] = mbin_power_mod_32(mod[x], mod[y] - 2, mod[y]);
+			mbin_mont_init_32(&m, mod[y]);
+			table[z++] = mbin_mont_inv_32(&m, mod[x]);
 		}
 	}
 }
@@ -96,6 +101,52 @@ mbin_lina_by_moda_lookup_32(uint32_t *ptr, const uint32_t *mod, const uint32_t *
 	}
 }
 
+/*
+ * Garner's algorithm using one inverse per modulus. "table[y]" is the
+ * inverse of the product of all moduli before "y", modulo "mod[y]".
+ * The moduli must be pairwise coprime.
+ */
+void
+mbin_mod_garner_create(const uint32_t *mod, uint32_t *table, const uint32_t n)
+{
+	struct mbin_mont_32 m;
+	uint64_t p;
+	uint32_t x;
+	uint32_t y;
+
+	for (y = 0; y != n; y++) {
+		for (p = 1, x = 0; x != y; x++)
+			p = (p * U64(mod[x])) % U64(mod[y]);
+		mbin_mont_init_32(&m, mod[y]);
+		table[y] = mbin_mont_inv_32(&m, p);
+	}
+}
+
+void
+mbin_lina_by_moda_garner_32(uint32_t *ptr, const uint32_t *mod, const uint32_t *table, const uint32_t n)
+{
+	uint64_t c;
+	uint64_t m;
+	uint64_t s;
+	uint32_t x;
+	uint32_t y;
+
+	for (y = 1; y < n; y++) {
+		m = mod[y];
+
+		/* evaluate the mixed radix digits found so far */
+		for (s = ptr[y - 1] % m, x = y - 1; x-- != 0; ) {
+			c = mod[x];
+			if (c >= m)
+				c %= m;
+			s = (s * c + ptr[x]) % m;
+		}
+
+		s = (m + (ptr[y] % m) - s) % m;
+		ptr[y] = (s * U64(table[y])) % m;
+	}
+}
+
 /* This function compute the modular values from a linear value */
 void
 mbin_moda_by_lina_slow_32(uint32_t *ptr, const uint32_t *mod, const uint32_t n)
@@ -146,11 +197,13 @@ void
 mbin_moda_div_32(const uint32_t *pa, const uint32_t *pb, uint32_t *pc,
     const uint32_t *mod, const uint32_t n)
 {
+	struct mbin_mont_32 m;
 	uint32_t x;
 
 	for (x = 0; x != n; x++) {
-		pc[x] = (U64(pa[x]) * U64(mbin_power_mod_32(pb[x],
-		    mod[x] - 2, mod[x]))) % U64(mod[x]);
+		mbin_mont_init_32(&m, mod[x]);
+		pc[x] = (U64(pa[x]) * U64(mbin_mont_inv_32(&m, pb[x]))) %
+		    U64(mod[x]);
 	}
 }
 
@@ -159,22 +212,167 @@ void
 mbin_moda_power_32(const uint32_t *pa, uint32_t *pc,
     const uint32_t *mod, const uint32_t power, const uint32_t n)
 {
+	struct mbin_mont_32 m;
 	uint32_t x;
 
-	for (x = 0; x != n; x++)
-		pc[x] = mbin_power_mod_32(pa[x], power, mod[x]);
+	for (x = 0; x != n; x++) {
+		if ((mod[x] & 1) == 0 || mod[x] < 3) {
+			pc[x] = mbin_power_mod_32(pa[x], power, mod[x]);
+			continue;
+		}
+		mbin_mont_init_32(&m, mod[x]);
+		pc[x] = mbin_mont_power_32(&m, pa[x], power);
+	}
+}
+
+/*
+ * Compute the Jacobi symbol (a / n) for odd "n". Returns -1, 0 or 1.
+ */
+int
+mbin_jacobi_32(uint32_t a, uint32_t n)
+{
+	uint32_t t;
+	int r = 1;
+
+	a %= n;
+	while (a != 0) {
+		t = __builtin_ctz(a);
+		a >>= t;
+		/* (2 / n) is -1 when n is 3 or 5 modulo 8 */
+		if ((t & 1) && ((n & 7) == 3 || (n & 7) == 5))
+			r = -r;
+		/* quadratic reciprocity */
+		if ((a & n & 3) == 3)
+			r = -r;
+		t = a;
+		a = n % a;
+		n = t;
+	}
+	return ((n == 1) ? r : 0);
+}
+
+/*
+ * Check if "x" is a square modulo the prime power "p" ** "k", "pk"
+ * being the prime power itself.
+ */
+static uint8_t
+mbin_mod_is_square_pk_32(uint32_t x, uint32_t p, uint32_t k, const uint32_t pk)
+{
+	x %= pk;
+	if (x == 0)
+		return (1);
+
+	/* remove even powers of "p" */
+	while ((x % p) == 0) {
+		x /= p;
+		if ((x % p) != 0)
+			return (0);
+		x /= p;
+		k -= 2;
+	}
+	if (p != 2)
+		return (mbin_jacobi_32(x, p) == 1);
+	if (k == 1)
+		return (1);
+	if (k == 2)
+		return ((x & 3) == 1);
+	return ((x & 7) == 1);
 }
 
+/*
+ * Check if "x" is a square modulo "mod". Odd prime moduli use Euler's
+ * criterion through the Jacobi symbol. Other moduli are factored and
+ * each prime power is checked separately.
+ */
 uint8_t
 mbin_mod_is_square_32(const uint32_t x, const uint32_t mod)
 {
-	uint32_t y;
+	uint32_t m;
+	uint32_t p;
+	uint32_t k;
+	uint32_t pk;
+
+	if (x >= mod)
+		return (0);
+	if (x == 0)
+		return (1);
+	if ((mod & 1) && mbin_is_prime_64(mod))
+		return (mbin_jacobi_32(x, mod) == 1);
+
+	for (m = mod, p = 2; m != 1; p += (p == 2) ? 1 : 2) {
+		if (U64(p) * U64(p) > m)
+			p = m;
+		if ((m % p) != 0)
+			continue;
+		for (k = 0, pk = 1; (m % p) == 0; k++) {
+			m /= p;
+			pk *= p;
+		}
+		if (!mbin_mod_is_square_pk_32(x, p, k, pk))
+			return (0);
+	}
+	return (1);
+}
+
+/*
+ * Compute a square root of "x" modulo the odd prime "mod", using the
+ * Tonelli-Shanks algorithm. The smaller of the two roots is stored
+ * in "proot". Returns zero if "x" is not a square.
+ */
+uint8_t
+mbin_mod_sqrt_32(const uint32_t x, const uint32_t mod, uint32_t *proot)
+{
+	struct mbin_mont_32 mont;
+	uint64_t b;
+	uint64_t c;
+	uint64_t r;
+	uint64_t t;
+	uint32_t q;
+	uint32_t s;
+	uint32_t z;
+	uint32_t i;
+	uint32_t j;
+	uint32_t m;
 
-	for (y = 0; y != mod; y++) {
-		if (((U64(y) * U64(y)) % U64(mod)) == x)
-			return (1);
+	if (x % mod == 0) {
+		*proot = 0;
+		return (1);
 	}
-	return (0);
+	if (mbin_jacobi_32(x, mod) != 1)
+		return (0);
+
+	mbin_mont_init_32(&mont, mod);
+
+	for (s = 0, q = mod - 1; (q & 1) == 0; s++)
+		q /= 2;
+
+	if (s == 1) {
+		r = mbin_mont_power_32(&mont, x, (mod + 1) / 4);
+	} else {
+		/* find a non-residue */
+		for (z = 2; mbin_jacobi_32(z, mod) != -1; z++)
+			;
+		c = mbin_mont_power_32(&mont, z, q);
+		r = mbin_mont_power_32(&mont, x, (q + 1) / 2);
+		t = mbin_mont_power_32(&mont, x, q);
+		m = s;
+
+		while (t != 1) {
+			/* find the order of "t" */
+			for (i = 0, b = t; b != 1; i++)
+				b = (b * b) % mod;
+			for (b = c, j = i + 1; j != m; j++)
+				b = (b * b) % mod;
+			m = i;
+			r = (r * b) % mod;
+			c = (b * b) % mod;
+			t = (t * c) % mod;
+		}
+	}
+	if (r > mod - r)
+		r = mod - r;
+	*proot = r;
+	return (1);
 }
 
 uint8_t
@@ -190,7 +388,32 @@ mbin_moda_is_square_32(const uint32_t *pa, const uint32_t *mod,
 	return (1);
 }
 
-/* compute leading value */
+/*
+ * Compute square roots of all residues, the moduli being odd primes.
+ * Returns zero if any residue is not a square, in which case the
+ * corresponding root is set to zero.
+ */
+uint8_t
+mbin_moda_sqrt_32(const uint32_t *pa, uint32_t *pc, const uint32_t *mod,
+    const uint32_t n)
+{
+	uint8_t retval = 1;
+	uint32_t x;
+
+	for (x = 0; x != n; x++) {
+		if (!mbin_mod_sqrt_32(pa[x], mod[x], pc + x)) {
+			pc[x] = 0;
+			retval = 0;
+		}
+	}
+	return (retval);
+}
+
+/*
+ * Compute leading value. The result is truncated to 32 bits. Use
+ * mbin_leading_by_lina_limb_32() when the product of the moduli
+ * does not fit.
+ */
 uint32_t
 mbin_leading_by_lina_32(const uint32_t *pa, const uint32_t *mod, const uint32_t n)
 {
@@ -217,6 +440,370 @@ mbin_lina_by_leading_32(uint32_t x, uint32_t *ptr, const uint32_t *mod, const ui
 	}
 }
 
+/*
+ * Compute leading value as a multi-limb integer, least significant
+ * limb first. Returns the number of limbs used, or "nlimb" + 1 if
+ * the value does not fit. Unused limbs are cleared.
+ */
+uint32_t
+mbin_leading_by_lina_limb_32(const uint32_t *pa, const uint32_t *mod, const uint32_t n,
+    uint32_t *limb, const uint32_t nlimb)
+{
+	uint64_t t;
+	uint32_t used;
+	uint32_t x;
+	uint32_t y;
+
+	for (y = 0; y != nlimb; y++)
+		limb[y] = 0;
+
+	/* Horner scheme from the most significant digit */
+	for (used = 0, x = n; x-- != 0; ) {
+		for (t = pa[x], y = 0; y != used; y++) {
+			t += U64(limb[y]) * U64(mod[x]);
+			limb[y] = (uint32_t)t;
+			t >>= 32;
+		}
+		if (t != 0) {
+			if (used == nlimb)
+				return (nlimb + 1);
+			limb[used++] = (uint32_t)t;
+		}
+	}
+	return (used);
+}
+
+/*
+ * Compute linear value from a multi-limb integer, least significant
+ * limb first. The limbs are destroyed. Returns non-zero if the value
+ * does not fit in the given moduli.
+ */
+uint8_t
+mbin_lina_by_leading_limb_32(uint32_t *limb, uint32_t nlimb, uint32_t *ptr,
+    const uint32_t *mod, const uint32_t n)
+{
+	uint64_t t;
+	uint32_t x;
+	uint32_t y;
+
+	for (y = 0; y != n; y++) {
+		while (nlimb != 0 && limb[nlimb - 1] == 0)
+			nlimb--;
+		for (t = 0, x = nlimb; x-- != 0; ) {
+			t = (t << 32) | limb[x];
+			limb[x] = t / mod[y];
+			t %= mod[y];
+		}
+		ptr[y] = t;
+	}
+	while (nlimb != 0 && limb[nlimb - 1] == 0)
+		nlimb--;
+	return (nlimb != 0);
+}
+
+/*========================================================================*
+ * Residue number system context
+ *========================================================================*/
+
+/*
+ * The context keeps the Montgomery constants of every modulus, which
+ * replaces the 64-bit division of every modular operation by two
+ * 32-bit multiplications. Even moduli fall back to division. Batched
+ * functions operate on "num" RNS numbers stored structure-of-arrays,
+ * "ptr[i * num + k]" being residue "i" of number "k", so that the
+ * inner loops run over one modulus and can be vectorised.
+ */
+struct mbin_rns_32 *
+mbin_rns_alloc_32(const uint32_t *mod, const uint32_t n)
+{
+	struct mbin_rns_32 *ctx;
+	uint32_t x;
+	uint32_t y;
+	uint32_t t;
+
+	ctx = malloc(sizeof(*ctx) + n * sizeof(struct mbin_mont_32) +
+	    (2 * n + (n * (n - 1) / 2)) * sizeof(uint32_t));
+	if (ctx == NULL)
+		return (NULL);
+
+	ctx->n = n;
+	ctx->mont = (struct mbin_mont_32 *)(ctx + 1);
+	ctx->mod = (uint32_t *)(ctx->mont + n);
+	ctx->table = ctx->mod + n;
+	ctx->garner = ctx->table + (n * (n - 1) / 2);
+
+	for (x = 0; x != n; x++) {
+		ctx->mod[x] = mod[x];
+		mbin_mont_init_32(&ctx->mont[x], mod[x]);
+	}
+
+	/* inverses used by the CRT, like mbin_mod_table_create() */
+	for (t = x = 0; x != n; x++) {
+		for (y = x + 1; y != n; y++)
+			ctx->table[t++] = mbin_mont_inv_32(&ctx->mont[y], mod[x]);
+	}
+	mbin_mod_garner_create(mod, ctx->garner, n);
+	return (ctx);
+}
+
+void
+mbin_rns_free_32(struct mbin_rns_32 *ctx)
+{
+	free(ctx);
+}
+
+void
+mbin_rns_add_32(const struct mbin_rns_32 *ctx, const uint32_t *pa,
+    const uint32_t *pb, uint32_t *pc, const size_t num)
+{
+	uint32_t i;
+	size_t k;
+
+	for (i = 0; i != ctx->n; i++) {
+		const uint32_t m = ctx->mod[i];
+
+		for (k = 0; k != num; k++) {
+			uint64_t t = U64(pa[k]) + U64(pb[k]);
+
+			pc[k] = (t >= m) ? (t - m) : t;
+		}
+		pa += num;
+		pb += num;
+		pc += num;
+	}
+}
+
+void
+mbin_rns_sub_32(const struct mbin_rns_32 *ctx, const uint32_t *pa,
+    const uint32_t *pb, uint32_t *pc, const size_t num)
+{
+	uint32_t i;
+	size_t k;
+
+	for (i = 0; i != ctx->n; i++) {
+		const uint32_t m = ctx->mod[i];
+
+		for (k = 0; k != num; k++)
+			pc[k] = (pa[k] >= pb[k]) ? (pa[k] - pb[k]) : (pa[k] + (m - pb[k]));
+		pa += num;
+		pb += num;
+		pc += num;
+	}
+}
+
+void
+mbin_rns_mul_32(const struct mbin_rns_32 *ctx, const uint32_t *pa,
+    const uint32_t *pb, uint32_t *pc, const size_t num)
+{
+	uint32_t i;
+	size_t k;
+
+	for (i = 0; i != ctx->n; i++) {
+		/* local copy, which the stores to "pc" cannot alias */
+		const struct mbin_mont_32 mont = ctx->mont[i];
+		const uint32_t m = ctx->mod[i];
+
+		if ((m & 1) == 0) {
+			for (k = 0; k != num; k++)
+				pc[k] = (U64(pa[k]) * U64(pb[k])) % U64(m);
+		} else {
+			for (k = 0; k != num; k++) {
+				pc[k] = mbin_mont_mul_32(&mont,
+				    mbin_mont_mul_32(&mont, pa[k], pb[k]), mont.r2);
+			}
+		}
+		pa += num;
+		pb += num;
+		pc += num;
+	}
+}
+
+/* multiply, in Montgomery form for odd moduli */
+static inline uint32_t
+mbin_rns_mulc_32(const struct mbin_mont_32 *pm, uint32_t a, uint32_t b)
+{
+	if ((pm->n & 1) == 0)
+		return ((U64(a) * U64(b)) % U64(pm->n));
+	return (mbin_mont_mul_32(pm, a, b));
+}
+
+/* convert "c" for use with mbin_rns_mulc_32() */
+static inline uint32_t
+mbin_rns_const_32(const struct mbin_mont_32 *pm, uint32_t c)
+{
+	if ((pm->n & 1) == 0)
+		return (c % pm->n);
+	return (mbin_mont_to_32(pm, c));
+}
+
+/*
+ * Multiplicative inverse "division". The divisors of every modulus
+ * are inverted together, using a single modular inverse per block
+ * of values. Divisors which have no inverse give a zero result.
+ */
+#define	MBIN_RNS_BLOCK 64
+
+/* compute the prefix products of the non-zero values */
+static inline uint32_t
+mbin_rns_prod_32(const struct mbin_mont_32 *pm, const uint32_t *val,
+    uint32_t *prod, size_t cnt)
+{
+	uint32_t p = mbin_rns_const_32(pm, 1);
+	size_t k;
+
+	for (k = 0; k != cnt; k++) {
+		if (val[k] != 0)
+			p = mbin_rns_mulc_32(pm, p, val[k]);
+		prod[k] = p;
+	}
+	return (p);
+}
+
+void
+mbin_rns_div_32(const struct mbin_rns_32 *ctx, const uint32_t *pa,
+    const uint32_t *pb, uint32_t *pc, const size_t num)
+{
+	uint32_t prod[MBIN_RNS_BLOCK];
+	uint32_t val[MBIN_RNS_BLOCK];
+	uint32_t inv;
+	uint32_t i;
+	size_t cnt;
+	size_t k;
+	size_t o;
+
+	for (i = 0; i != ctx->n; i++) {
+		const struct mbin_mont_32 mont = ctx->mont[i];
+		const struct mbin_mont_32 *pm = &mont;
+		const uint32_t m = ctx->mod[i];
+
+		for (o = 0; o != num; o += cnt) {
+			cnt = num - o;
+			if (cnt > MBIN_RNS_BLOCK)
+				cnt = MBIN_RNS_BLOCK;
+
+			/* reduce the divisors once */
+			for (k = 0; k != cnt; k++)
+				val[k] = mbin_rns_const_32(pm, pb[o + k]);
+
+			inv = mbin_mont_inv_32(pm, mbin_rns_mulc_32(pm,
+			    mbin_rns_prod_32(pm, val, prod, cnt), 1));
+			if (inv == 0) {
+				/* skip the divisors which have no inverse */
+				for (k = 0; k != cnt; k++) {
+					if (val[k] != 0 &&
+					    mbin_gcd_64(val[k], m) != 1)
+						val[k] = 0;
+				}
+				inv = mbin_mont_inv_32(pm, mbin_rns_mulc_32(pm,
+				    mbin_rns_prod_32(pm, val, prod, cnt), 1));
+			}
+			inv = mbin_rns_const_32(pm, inv);
+
+			for (k = cnt; k-- != 0; ) {
+				if (val[k] == 0) {
+					pc[o + k] = 0;
+					continue;
+				}
+				pc[o + k] = mbin_rns_mulc_32(pm, pa[o + k],
+				    (k != 0) ? mbin_rns_mulc_32(pm, inv, prod[k - 1]) : inv);
+				inv = mbin_rns_mulc_32(pm, inv, val[k]);
+			}
+		}
+		pa += num;
+		pb += num;
+		pc += num;
+	}
+}
+
+void
+mbin_rns_power_32(const struct mbin_rns_32 *ctx, const uint32_t *pa,
+    uint32_t *pc, const uint32_t power, const size_t num)
+{
+	uint32_t i;
+	size_t k;
+
+	for (i = 0; i != ctx->n; i++) {
+		const uint32_t m = ctx->mod[i];
+
+		if ((m & 1) != 0) {
+			mbin_mont_power_array_32(&ctx->mont[i], pa, pc, power, num);
+		} else {
+			for (k = 0; k != num; k++)
+				pc[k] = mbin_power_mod_32(pa[k], power, m);
+		}
+		pa += num;
+		pc += num;
+	}
+}
+
+/*
+ * Batched version of mbin_lina_by_moda_garner_32(). Converts "num"
+ * RNS numbers, stored like for the other batched functions, into
+ * mixed radix digits in place. The digits can then be turned into
+ * multi-limb integers using mbin_leading_by_lina_limb_32().
+ */
+void
+mbin_rns_lina_32(const struct mbin_rns_32 *ctx, uint32_t *ptr, const size_t num)
+{
+	uint32_t s[MBIN_RNS_BLOCK];
+	uint32_t *pd;
+	uint32_t c;
+	uint32_t d;
+	uint32_t t;
+	uint32_t x;
+	uint32_t y;
+	size_t cnt;
+	size_t k;
+	size_t o;
+
+	for (y = 1; y < ctx->n; y++) {
+		const struct mbin_mont_32 mont = ctx->mont[y];
+		const struct mbin_mont_32 *pm = &mont;
+		const uint32_t m = ctx->mod[y];
+		const uint32_t one = mbin_rns_const_32(pm, 1);
+		const uint32_t inv = mbin_rns_const_32(pm, ctx->garner[y]);
+		uint32_t *pr = ptr + (y * num);
+
+		for (o = 0; o != num; o += cnt) {
+			cnt = num - o;
+			if (cnt > MBIN_RNS_BLOCK)
+				cnt = MBIN_RNS_BLOCK;
+
+			pd = ptr + ((y - 1) * num) + o;
+			for (k = 0; k != cnt; k++)
+				s[k] = mbin_rns_mulc_32(pm, pd[k], one);
+
+			for (x = y - 1; x-- != 0; ) {
+				c = mbin_rns_const_32(pm, ctx->mod[x]);
+				pd = ptr + (x * num) + o;
+
+				if (ctx->mod[x] > m) {
+					for (k = 0; k != cnt; k++) {
+						t = mbin_rns_mulc_32(pm, s[k], c);
+						d = mbin_rns_mulc_32(pm, pd[k], one);
+						t += d;
+						s[k] = (t >= m || t < d) ? (t - m) : t;
+					}
+				} else {
+					/* digit is already below the modulus */
+					for (k = 0; k != cnt; k++) {
+						t = mbin_rns_mulc_32(pm, s[k], c);
+						d = pd[k];
+						t += d;
+						s[k] = (t >= m || t < d) ? (t - m) : t;
+					}
+				}
+			}
+
+			for (k = 0; k != cnt; k++) {
+				t = pr[o + k];
+				t = (t >= s[k]) ? (t - s[k]) : (t + (m - s[k]));
+				pr[o + k] = mbin_rns_mulc_32(pm, t, inv);
+			}
+		}
+	}
+}
+
 /*========================================================================*
  * XOR2 - mod array
  *========================================================================*/
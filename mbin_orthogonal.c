@@ -32,11 +32,6 @@
 
 #include "math_bin.h"
 
-struct mbin_okey {
-	STAILQ_ENTRY(mbin_okey) entry;
-	uint32_t key;
-};
-
 static uint8_t
 mbin_okey_compress_8(uint32_t val, uint32_t kmask)
 {
@@ -57,59 +52,82 @@ void
 mbin_find_orthogonal_key_32(const uint32_t *ptr, uint32_t max,
     uint32_t kmask, uint32_t **pres)
 {
-	uint32_t n;
-	uint32_t mask;
-	uint32_t x;
-	uint32_t y;
-	uint8_t *ptmp;
-	uint8_t *pcmp;
-	struct mbin_okey *pkey;
-	STAILQ_HEAD(, mbin_okey) head = STAILQ_HEAD_INITIALIZER(head);
-
-	*pres = NULL;
-
-	mask = -1U;
-
-	for (x = 0; x != max; x++)
-		mask &= ~(ptr[x] ^ ptr[0]);
-
-	/* mask should now contain all non-changing bits */
+	mbin_find_orthogonal_key_mt_32(ptr, max, kmask, pres, 1);
+}
 
-	mask = ~mask & ~kmask;
+/*
+ * Find all minimal keys, in increasing order, such that the input
+ * values masked by the key determine the bits selected by "kmask".
+ * The candidate keys are visited by increasing number of set bits,
+ * so that every subset of a candidate is decided before the candidate
+ * itself. All candidates having the same number of set bits are
+ * tested in parallel. A byte per candidate records whether the
+ * candidate, or any of its subsets, is a key. That replaces a scan of
+ * all found keys with one lookup per set bit. The result array is
+ * terminated by -1U and must be freed by the caller.
+ */
+struct mbin_okey_mt {
+	const uint32_t *ptr;
+	const uint8_t *pcmp;
+	uint8_t *pcov;
+	uint32_t dep[4][256];
+	uint32_t max;
+	uint32_t ntmp;
+	uint32_t bits;
+	uint32_t level;
+	int	error;
+	struct mbin_okey_res {
+		uint32_t *key;
+		uint32_t num;
+		uint32_t alloc;
+	} res[];
+};
 
-	n = mbin_msb32(mask) * 2;
-	if (n == 0)
-		return;
+static void
+mbin_okey_mt_worker(void *arg, uint32_t index, uint32_t num)
+{
+	struct mbin_okey_mt *pmt = arg;
+	struct mbin_okey_res *pres = pmt->res + index;
+	const uint32_t *ptr = pmt->ptr;
+	const uint8_t *pcmp = pmt->pcmp;
+	uint8_t *pcov = pmt->pcov;
+	uint8_t *ptmp;
+	uint32_t i;
+	uint32_t b;
+	uint32_t c;
+	uint32_t t;
+	uint32_t x;
+	uint32_t y;
+	uint32_t z;
 
-	ptmp = malloc(n);
-	if (ptmp == NULL)
+	ptmp = malloc(pmt->ntmp);
+	if (ptmp == NULL) {
+		pmt->error = 1;
 		return;
+	}
+	memset(ptmp, 0, pmt->ntmp);
 
-	memset(ptmp, 0, n);
+	/* visit all indices having "level" bits set, in increasing order */
+	i = (pmt->level == 0) ? 0 : ((1ULL << pmt->level) - 1);
 
-	pcmp = malloc(max);
-	if (pcmp == NULL) {
-		free(ptmp);
-		return;
-	}
-	for (x = 0; x != max; x++) {
-		pcmp[x] = mbin_okey_compress_8(ptr[x], kmask) + 1;
-	}
+	for (z = 0; ; z++) {
+		if ((z % num) != index)
+			goto next;
 
-	for (y = 0; y <= mask; y++) {
-		while (y & ~mask)
-			y += (y & ~mask);
-		if (y > mask)
-			break;
-		STAILQ_FOREACH(pkey, &head, entry) {
-			if ((pkey->key & y) == pkey->key)
+		/* check if a key is a subset */
+		for (t = i; t != 0; t &= t - 1) {
+			if (pcov[i & ~(t & -t)])
 				break;
 		}
-		if (pkey != NULL)
-			continue;
+		if (t != 0) {
+			pcov[i] = 1;
+			goto next;
+		}
 
-		for (x = 0; x != max; x++) {
+		y = pmt->dep[0][i & 0xFF] | pmt->dep[1][(i >> 8) & 0xFF] |
+		    pmt->dep[2][(i >> 16) & 0xFF] | pmt->dep[3][(i >> 24) & 0xFF];
 
+		for (x = 0; x != pmt->max; x++) {
 			uint8_t val;
 
 			val = pcmp[x];
@@ -122,32 +140,137 @@ mbin_find_orthogonal_key_32(const uint32_t *ptr, uint32_t max,
 			}
 		}
 
-		if (x == max) {
-			pkey = alloca(sizeof(*pkey));
-			pkey->key = y;
-			STAILQ_INSERT_TAIL(&head, pkey, entry);
+		if (x == pmt->max) {
+			if (pres->num == pres->alloc) {
+				uint32_t *pkey;
+
+				pres->alloc = pres->alloc ? 2 * pres->alloc : 16;
+				pkey = realloc(pres->key, pres->alloc * sizeof(pkey[0]));
+				if (pkey == NULL) {
+					pmt->error = 1;
+					break;
+				}
+				pres->key = pkey;
+			}
+			pres->key[pres->num++] = y;
+			pcov[i] = 1;
 		}
 		/* cleanup */
 		while (x--) {
 			ptmp[y & ptr[x]] = 0;
 		}
+next:
+		if (pmt->level == 0 || pmt->level == pmt->bits)
+			break;
+		/* next index with the same number of set bits */
+		b = i & -i;
+		c = i + b;
+		if (c >= (1ULL << pmt->bits) || c == 0)
+			break;
+		i = c | (((c ^ i) >> 2) / b);
 	}
-
-	free(pcmp);
 	free(ptmp);
+}
+
+static int
+mbin_okey_compare(const void *pa, const void *pb)
+{
+	uint32_t a = *(const uint32_t *)pa;
+	uint32_t b = *(const uint32_t *)pb;
+
+	return ((a > b) - (a < b));
+}
+
+void
+mbin_find_orthogonal_key_mt_32(const uint32_t *ptr, uint32_t max,
+    uint32_t kmask, uint32_t **pres, uint32_t nthreads)
+{
+	struct mbin_okey_mt *pmt;
+	uint8_t *pcmp;
+	uint32_t *pkey;
+	uint32_t mask;
+	uint32_t n;
+	uint32_t x;
+	uint32_t y;
+	uint32_t z;
 
-	n = 1;
-	STAILQ_FOREACH(pkey, &head, entry)
-	    n++;
+	*pres = NULL;
 
-	*pres = malloc(n * sizeof(**pres));
+	if (nthreads < 1)
+		nthreads = 1;
 
-	if (*pres != NULL) {
-		n = 0;
+	mask = -1U;
 
-		STAILQ_FOREACH(pkey, &head, entry)
-		    (*pres)[n++] = pkey->key;
+	for (x = 0; x != max; x++)
+		mask &= ~(ptr[x] ^ ptr[0]);
 
-		(*pres)[n++] = -1U;
+	/* mask should now contain all non-changing bits */
+
+	mask = ~mask & ~kmask;
+
+	n = mbin_msb32(mask) * 2;
+	if (n == 0)
+		return;
+
+	pmt = malloc(sizeof(*pmt) + nthreads * sizeof(pmt->res[0]));
+	if (pmt == NULL)
+		return;
+	memset(pmt, 0, sizeof(*pmt) + nthreads * sizeof(pmt->res[0]));
+
+	pmt->bits = mbin_sumbits32(mask);
+	pmt->ptr = ptr;
+	pmt->max = max;
+	pmt->ntmp = n;
+
+	/* tables to deposit index bits into the mask */
+	for (y = x = 0; x != 32; x++) {
+		if (!(mask & (1U << x)))
+			continue;
+		for (z = 0; z != 256; z++) {
+			if (z & (1U << (y % 8)))
+				pmt->dep[y / 8][z] |= (1U << x);
+		}
+		y++;
 	}
+
+	pcmp = malloc(max);
+	pmt->pcov = malloc(1ULL << pmt->bits);
+	if (pcmp == NULL || pmt->pcov == NULL)
+		goto done;
+	memset(pmt->pcov, 0, 1ULL << pmt->bits);
+
+	for (x = 0; x != max; x++) {
+		pcmp[x] = mbin_okey_compress_8(ptr[x], kmask) + 1;
+	}
+	pmt->pcmp = pcmp;
+
+	for (pmt->level = 0; pmt->level <= pmt->bits; pmt->level++) {
+		if (nthreads == 1)
+			mbin_okey_mt_worker(pmt, 0, 1);
+		else
+			mbin_thread_run(&mbin_okey_mt_worker, pmt, nthreads);
+		if (pmt->error)
+			goto done;
+	}
+
+	for (n = 1, x = 0; x != nthreads; x++)
+		n += pmt->res[x].num;
+
+	pkey = malloc(n * sizeof(pkey[0]));
+	if (pkey == NULL)
+		goto done;
+
+	for (n = x = 0; x != nthreads; x++) {
+		for (y = 0; y != pmt->res[x].num; y++)
+			pkey[n++] = pmt->res[x].key[y];
+	}
+	qsort(pkey, n, sizeof(pkey[0]), &mbin_okey_compare);
+	pkey[n] = -1U;
+	*pres = pkey;
+done:
+	for (x = 0; x != nthreads; x++)
+		free(pmt->res[x].key);
+	free(pmt->pcov);
+	free(pcmp);
+	free(pmt);
 }
@@ -23,6 +23,7 @@
  * SUCH DAMAGE.
  */
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "math_bin.h"
@@ -53,3 +54,13 @@ mbin_polarise8(uint8_t val, uint8_t neg_pol)
 {
 	return ((val + neg_pol) ^ neg_pol);
 }
+
+void
+mbin_polarise_array_32(const uint32_t *src, uint32_t *dst, size_t num,
+    uint32_t neg_pol)
+{
+	size_t x;
+
+	for (x = 0; x != num; x++)
+		dst[x] = (src[x] + neg_pol) ^ neg_pol;
+}
@@ -23,7 +23,9 @@
  * SUCH DAMAGE.
  */
 
+#include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 #include "math_bin.h"
 
@@ -467,7 +469,10 @@ mbin_inv_odd_non_linear_32(uint32_t val, uint32_t mod)
 uint32_t
 mbin_inv_odd_prime_32(uint32_t val, uint32_t mod)
 {
-	return (mbin_power_mod_32(val, mod - 2, mod));
+	struct mbin_mont_32 m;
+
+	mbin_mont_init_32(&m, mod);
+	return (mbin_mont_inv_32(&m, val));
 }
 
 /* Standard converging power series for cosinus in 2-adic form: */
@@ -549,22 +554,77 @@ mbin_sin_b2_odd_64(uint64_t x)
 	return (s);
 }
 
-/* greatest common divisor, Euclid equation */
+/* greatest common divisor, binary (Stein) algorithm */
 uint64_t
 mbin_gcd_64(uint64_t a, uint64_t b)
 {
-	uint64_t an;
-	uint64_t bn;
+	uint64_t d;
+	int k;
+	int n;
+
+	if (a == 0)
+		return (b);
+	if (b == 0)
+		return (a);
+
+	k = __builtin_ctzll(a | b);
+	a >>= __builtin_ctzll(a);
+	b >>= __builtin_ctzll(b);
+
+	/* the shift count does not depend on the sign of the difference */
+	while (a != b) {
+		d = b - a;
+		n = __builtin_ctzll(d);
+		if (a > b) {
+			a = b;
+			d = -d;
+		}
+		b = d >> n;
+	}
+	return (a << k);
+}
+
+/*
+ * Extended Euclid equation. Returns the greatest common divisor "g"
+ * and computes "x" and "y" so that a * x + b * y = g.
+ */
+uint64_t
+mbin_gcd_extended_64(uint64_t a, uint64_t b, int64_t *px, int64_t *py)
+{
+	int64_t x = 0;
+	int64_t y = 1;
+	int64_t lastx = 1;
+	int64_t lasty = 0;
+	int64_t t;
+	uint64_t q;
+	uint64_t r;
 
 	while (b != 0) {
-		an = b;
-		bn = a % b;
-		a = an;
-		b = bn;
+		q = a / b;
+		r = a - q * b;
+		a = b;
+		b = r;
+		t = lastx - (int64_t)q * x;
+		lastx = x;
+		x = t;
+		t = lasty - (int64_t)q * y;
+		lasty = y;
+		y = t;
 	}
+	*px = lastx;
+	*py = lasty;
 	return (a);
 }
 
+void
+mbin_gcd_array_64(const uint64_t *pa, const uint64_t *pb, uint64_t *pc, size_t num)
+{
+	size_t x;
+
+	for (x = 0; x != num; x++)
+		pc[x] = mbin_gcd_64(pa[x], pb[x]);
+}
+
 uint64_t
 mbin_factor_slow_64(uint64_t x)
 {
@@ -657,3 +717,633 @@ mbin_factor_slowest_64(uint64_t x)
 	}
 	return (0);	/* not reachable */
 }
+
+/*
+ * Montgomery arithmetic for odd moduli. Residues are kept multiplied
+ * by 2**32, respectively 2**64, modulo "n", which turns the division
+ * of every modular multiplication into two multiplications. The
+ * 128-bit products are computed from 32-bit halves. Batched
+ * exponentiation uses a sliding window of up to MBIN_MONT_WIN bits and
+ * works on blocks of MBIN_MONT_BLOCK numbers, so that the independent
+ * multiplications can overlap.
+ */
+#define	MBIN_MONT_WIN 3
+#define	MBIN_MONT_BLOCK 64
+
+/* "n" must be odd, except when only used for mbin_mont_inv_32() */
+void
+mbin_mont_init_32(struct mbin_mont_32 *pm, uint32_t n)
+{
+	uint32_t t;
+	int x;
+
+	/* Newton iteration for the inverse modulo 2**32 */
+	for (t = n, x = 0; x != 4; x++)
+		t *= 2 - (n * t);
+
+	pm->n = n;
+	pm->ninv = -t;
+	pm->one = (1ULL << 32) % n;
+	pm->r2 = ((uint64_t)pm->one * (uint64_t)pm->one) % n;
+}
+
+/*
+ * Raise the "num" Montgomery form values in "pa" to the power of "y",
+ * in place. "num" must not exceed MBIN_MONT_BLOCK.
+ */
+static void
+mbin_mont_exp_32(const struct mbin_mont_32 *pm, uint32_t *pa, uint32_t y,
+    size_t num)
+{
+	uint32_t tab[1 << (MBIN_MONT_WIN - 1)][MBIN_MONT_BLOCK];
+	uint32_t d;
+	size_t k;
+	int first;
+	int w;
+	int i;
+	int l;
+	int x;
+
+	if (y == 0) {
+		for (k = 0; k != num; k++)
+			pa[k] = pm->one;
+		return;
+	}
+
+	/* small exponents are not worth the table */
+	w = (y < (1U << (4 * MBIN_MONT_WIN))) ? 1 : MBIN_MONT_WIN;
+
+	/* compute the odd powers */
+	for (k = 0; k != num; k++)
+		tab[0][k] = pa[k];
+	if (w > 1) {
+		for (k = 0; k != num; k++)
+			pa[k] = mbin_mont_mul_32(pm, pa[k], pa[k]);
+		for (x = 1; x != (1 << (w - 1)); x++) {
+			for (k = 0; k != num; k++)
+				tab[x][k] = mbin_mont_mul_32(pm, tab[x - 1][k], pa[k]);
+		}
+	}
+
+	for (i = 31 - __builtin_clz(y), first = 1; i >= 0; ) {
+		if (((y >> i) & 1) == 0) {
+			for (k = 0; k != num; k++)
+				pa[k] = mbin_mont_mul_32(pm, pa[k], pa[k]);
+			i--;
+			continue;
+		}
+		/* find the longest window ending in a set bit */
+		l = (i >= w) ? (i - w + 1) : 0;
+		while (((y >> l) & 1) == 0)
+			l++;
+		d = (y >> l) & ((2U << (i - l)) - 1);
+
+		if (first) {
+			for (k = 0; k != num; k++)
+				pa[k] = tab[d / 2][k];
+			first = 0;
+		} else {
+			for (x = l; x <= i; x++) {
+				for (k = 0; k != num; k++)
+					pa[k] = mbin_mont_mul_32(pm, pa[k], pa[k]);
+			}
+			for (k = 0; k != num; k++)
+				pa[k] = mbin_mont_mul_32(pm, pa[k], tab[d / 2][k]);
+		}
+		i = l - 1;
+	}
+}
+
+/*
+ * A single exponentiation is bound by the latency of the
+ * multiplications. Going from the least significant bit lets the
+ * squarings overlap with the multiplications, which is faster than
+ * using the window.
+ */
+uint32_t
+mbin_mont_power_32(const struct mbin_mont_32 *pm, uint32_t x, uint32_t y)
+{
+	uint32_t r = pm->one;
+
+	x = mbin_mont_to_32(pm, x);
+	while (y) {
+		if (y & 1)
+			r = mbin_mont_mul_32(pm, r, x);
+		x = mbin_mont_mul_32(pm, x, x);
+		y /= 2;
+	}
+	return (mbin_mont_from_32(pm, r));
+}
+
+/* compute "pc[k] = pa[k] ** y", "pa" and "pc" may be the same array */
+void
+mbin_mont_power_array_32(const struct mbin_mont_32 *pm, const uint32_t *pa,
+    uint32_t *pc, uint32_t y, size_t num)
+{
+	uint32_t temp[MBIN_MONT_BLOCK];
+	size_t n;
+	size_t k;
+
+	for (; num != 0; num -= n) {
+		n = (num > MBIN_MONT_BLOCK) ? MBIN_MONT_BLOCK : num;
+		for (k = 0; k != n; k++)
+			temp[k] = mbin_mont_to_32(pm, pa[k]);
+		mbin_mont_exp_32(pm, temp, y, n);
+		for (k = 0; k != n; k++)
+			pc[k] = mbin_mont_from_32(pm, temp[k]);
+		pa += n;
+		pc += n;
+	}
+}
+
+/*
+ * Multiplicative inverse using the extended Euclidean algorithm, 0 if
+ * none. The coefficients alternate in sign, so only their absolute
+ * values are kept. Only "n" is used, so the modulus may be even.
+ */
+uint32_t
+mbin_mont_inv_32(const struct mbin_mont_32 *pm, uint32_t x)
+{
+	const uint32_t n = pm->n;
+	uint32_t r0 = n;
+	uint32_t r1 = x % n;
+	uint32_t t0 = 0;
+	uint32_t t1 = 1;
+	uint32_t q;
+	uint32_t t;
+	uint8_t odd = 0;
+
+	if (r1 == 0)
+		return (0);
+
+	while (r1 != 0) {
+		q = r0 / r1;
+		t = r0 - (q * r1);
+		r0 = r1;
+		r1 = t;
+		t = t0 + (q * t1);
+		t0 = t1;
+		t1 = t;
+		odd ^= 1;
+	}
+	if (r0 != 1)
+		return (0);
+	return (odd ? t0 : (n - t0));
+}
+
+static inline uint64_t
+mbin_mul_hilo_64(uint64_t a, uint64_t b, uint64_t *phi)
+{
+	const uint64_t al = (uint32_t)a;
+	const uint64_t ah = a >> 32;
+	const uint64_t bl = (uint32_t)b;
+	const uint64_t bh = b >> 32;
+	const uint64_t ll = al * bl;
+	const uint64_t lh = al * bh;
+	const uint64_t hl = ah * bl;
+	const uint64_t hh = ah * bh;
+	const uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+
+	*phi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+	return ((mid << 32) | (uint32_t)ll);
+}
+
+static inline uint64_t
+mbin_mont_mul_64(const struct mbin_mont_64 *pm, uint64_t a, uint64_t b)
+{
+	uint64_t hi;
+	uint64_t mh;
+	uint64_t lo;
+	uint64_t r;
+	int carry;
+
+	lo = mbin_mul_hilo_64(a, b, &hi);
+	mbin_mul_hilo_64(lo * pm->ninv, pm->n, &mh);
+
+	/* the low halves sum to zero, with a carry unless both are zero */
+	r = hi + mh;
+	carry = (r < hi);
+	r += (lo != 0);
+	carry |= (r < (lo != 0));
+	if (carry || r >= pm->n)
+		r -= pm->n;
+	return (r);
+}
+
+static inline uint64_t
+mbin_mont_add_64(const struct mbin_mont_64 *pm, uint64_t a, uint64_t b)
+{
+	uint64_t r = a + b;
+
+	if (r < a || r >= pm->n)
+		r -= pm->n;
+	return (r);
+}
+
+/* "n" must be odd */
+void
+mbin_mont_init_64(struct mbin_mont_64 *pm, uint64_t n)
+{
+	uint64_t t;
+	int x;
+
+	/* Newton iteration for the inverse modulo 2**64 */
+	for (t = n, x = 0; x != 5; x++)
+		t *= 2 - (n * t);
+
+	pm->n = n;
+	pm->ninv = -t;
+	pm->one = -n % n;
+	pm->r2 = pm->one;
+	for (x = 0; x != 64; x++)
+		pm->r2 = mbin_mont_add_64(pm, pm->r2, pm->r2);
+}
+
+static inline uint64_t
+mbin_mont_to_64(const struct mbin_mont_64 *pm, uint64_t a)
+{
+	return (mbin_mont_mul_64(pm, a % pm->n, pm->r2));
+}
+
+static inline uint64_t
+mbin_mont_from_64(const struct mbin_mont_64 *pm, uint64_t a)
+{
+	return (mbin_mont_mul_64(pm, a, 1));
+}
+
+/*
+ * Raise the "num" Montgomery form values in "pa" to the power of "y",
+ * in place. "num" must not exceed MBIN_MONT_BLOCK.
+ */
+static void
+mbin_mont_exp_64(const struct mbin_mont_64 *pm, uint64_t *pa, uint64_t y,
+    size_t num)
+{
+	uint64_t tab[1 << (MBIN_MONT_WIN - 1)][MBIN_MONT_BLOCK];
+	uint64_t d;
+	size_t k;
+	int first;
+	int w;
+	int i;
+	int l;
+	int x;
+
+	if (y == 0) {
+		for (k = 0; k != num; k++)
+			pa[k] = pm->one;
+		return;
+	}
+
+	/* small exponents are not worth the table */
+	w = (y < (1ULL << (4 * MBIN_MONT_WIN))) ? 1 : MBIN_MONT_WIN;
+
+	/* compute the odd powers */
+	for (k = 0; k != num; k++)
+		tab[0][k] = pa[k];
+	if (w > 1) {
+		for (k = 0; k != num; k++)
+			pa[k] = mbin_mont_mul_64(pm, pa[k], pa[k]);
+		for (x = 1; x != (1 << (w - 1)); x++) {
+			for (k = 0; k != num; k++)
+				tab[x][k] = mbin_mont_mul_64(pm, tab[x - 1][k], pa[k]);
+		}
+	}
+
+	for (i = 63 - __builtin_clzll(y), first = 1; i >= 0; ) {
+		if (((y >> i) & 1) == 0) {
+			for (k = 0; k != num; k++)
+				pa[k] = mbin_mont_mul_64(pm, pa[k], pa[k]);
+			i--;
+			continue;
+		}
+		/* find the longest window ending in a set bit */
+		l = (i >= w) ? (i - w + 1) : 0;
+		while (((y >> l) & 1) == 0)
+			l++;
+		d = (y >> l) & ((2ULL << (i - l)) - 1);
+
+		if (first) {
+			for (k = 0; k != num; k++)
+				pa[k] = tab[d / 2][k];
+			first = 0;
+		} else {
+			for (x = l; x <= i; x++) {
+				for (k = 0; k != num; k++)
+					pa[k] = mbin_mont_mul_64(pm, pa[k], pa[k]);
+			}
+			for (k = 0; k != num; k++)
+				pa[k] = mbin_mont_mul_64(pm, pa[k], tab[d / 2][k]);
+		}
+		i = l - 1;
+	}
+}
+
+uint64_t
+mbin_mont_power_64(const struct mbin_mont_64 *pm, uint64_t x, uint64_t y)
+{
+	uint64_t r = pm->one;
+
+	x = mbin_mont_to_64(pm, x);
+	while (y) {
+		if (y & 1)
+			r = mbin_mont_mul_64(pm, r, x);
+		x = mbin_mont_mul_64(pm, x, x);
+		y /= 2;
+	}
+	return (mbin_mont_from_64(pm, r));
+}
+
+/* compute "pc[k] = pa[k] ** y", "pa" and "pc" may be the same array */
+void
+mbin_mont_power_array_64(const struct mbin_mont_64 *pm, const uint64_t *pa,
+    uint64_t *pc, uint64_t y, size_t num)
+{
+	uint64_t temp[MBIN_MONT_BLOCK];
+	size_t n;
+	size_t k;
+
+	for (; num != 0; num -= n) {
+		n = (num > MBIN_MONT_BLOCK) ? MBIN_MONT_BLOCK : num;
+		for (k = 0; k != n; k++)
+			temp[k] = mbin_mont_to_64(pm, pa[k]);
+		mbin_mont_exp_64(pm, temp, y, n);
+		for (k = 0; k != n; k++)
+			pc[k] = mbin_mont_from_64(pm, temp[k]);
+		pa += n;
+		pc += n;
+	}
+}
+
+/*
+ * Multiplicative inverse using the extended Euclidean algorithm, 0 if
+ * none. The coefficients alternate in sign, so only their absolute
+ * values are kept.
+ */
+uint64_t
+mbin_mont_inv_64(const struct mbin_mont_64 *pm, uint64_t x)
+{
+	const uint64_t n = pm->n;
+	uint64_t r0 = n;
+	uint64_t r1 = x % n;
+	uint64_t t0 = 0;
+	uint64_t t1 = 1;
+	uint64_t q;
+	uint64_t t;
+	uint8_t odd = 0;
+
+	if (r1 == 0)
+		return (0);
+
+	while (r1 != 0) {
+		q = r0 / r1;
+		t = r0 - (q * r1);
+		r0 = r1;
+		r1 = t;
+		t = t0 + (q * t1);
+		t0 = t1;
+		t1 = t;
+		odd ^= 1;
+	}
+	if (r0 != 1)
+		return (0);
+	return (odd ? t0 : (n - t0));
+}
+
+/* deterministic Miller-Rabin test, valid for all 64-bit numbers */
+uint8_t
+mbin_is_prime_64(uint64_t x)
+{
+	static const uint64_t base[7] = {
+		2, 325, 9375, 28178, 450775, 9780504, 1795265022
+	};
+	static const uint8_t small[] = {
+		2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37
+	};
+	struct mbin_mont_64 m;
+	uint64_t d;
+	uint64_t y;
+	uint64_t a;
+	uint32_t s;
+	uint32_t i;
+	uint32_t j;
+
+	if (x < 2)
+		return (0);
+	for (i = 0; i != sizeof(small); i++) {
+		if (x == small[i])
+			return (1);
+		if ((x % small[i]) == 0)
+			return (0);
+	}
+	if (x < 41 * 41)
+		return (1);
+
+	mbin_mont_init_64(&m, x);
+
+	for (s = 0, d = x - 1; (d & 1) == 0; s++)
+		d /= 2;
+
+	for (i = 0; i != 7; i++) {
+		a = base[i] % x;
+		if (a == 0)
+			continue;
+		y = mbin_mont_to_64(&m, mbin_mont_power_64(&m, a, d));
+		if (y == m.one || y == x - m.one)
+			continue;
+		for (j = 1; j != s; j++) {
+			y = mbin_mont_mul_64(&m, y, y);
+			if (y == x - m.one)
+				break;
+		}
+		if (j == s)
+			return (0);
+	}
+	return (1);
+}
+
+/*
+ * Pollard-Brent rho for the odd composite "x". Returns a non-trivial
+ * factor, or zero if the iteration failed for this constant.
+ */
+static uint64_t
+mbin_factor_rho_64(uint64_t x, uint64_t c)
+{
+	struct mbin_mont_64 m;
+	uint64_t g = 1;
+	uint64_t q;
+	uint64_t r;
+	uint64_t k;
+	uint64_t i;
+	uint64_t y;
+	uint64_t ys;
+	uint64_t z;
+
+	mbin_mont_init_64(&m, x);
+
+	c = mbin_mont_to_64(&m, c);
+	q = m.one;
+	y = m.one;
+	ys = y;
+	z = y;
+
+	for (r = 1; g == 1; r *= 2) {
+		z = y;
+		for (i = 0; i != r; i++)
+			y = mbin_mont_add_64(&m, mbin_mont_mul_64(&m, y, y), c);
+
+		/* accumulate differences, taking a GCD every 128 steps */
+		for (k = 0; k < r && g == 1; k += 128) {
+			ys = y;
+			for (i = 0; i != 128 && i < r - k; i++) {
+				y = mbin_mont_add_64(&m, mbin_mont_mul_64(&m, y, y), c);
+				q = mbin_mont_mul_64(&m, q, (z > y) ? (z - y) : (y - z));
+			}
+			g = mbin_gcd_64(q, x);
+		}
+		if (r >= (1ULL << 40))
+			return (0);
+	}
+
+	if (g == x) {
+		/* backtrack one step at a time */
+		do {
+			ys = mbin_mont_add_64(&m, mbin_mont_mul_64(&m, ys, ys), c);
+			g = mbin_gcd_64((z > ys) ? (z - ys) : (ys - z), x);
+		} while (g == 1);
+	}
+	return ((g == x) ? 0 : g);
+}
+
+/*
+ * Return a non-trivial factor of "x", or zero if "x" is prime or
+ * below two. Uses a Miller-Rabin test and Pollard-Brent rho.
+ */
+uint64_t
+mbin_factor_fast_64(uint64_t x)
+{
+	uint64_t c;
+	uint64_t f;
+	uint64_t y;
+
+	if (x <= 1)
+		return (0);
+	if (!(x & 1))
+		return ((x == 2) ? 0 : 2);
+	for (y = 3; y != 41; y += 2) {
+		if ((x % y) == 0)
+			return ((x == y) ? 0 : y);
+	}
+	if (mbin_is_prime_64(x))
+		return (0);
+
+	/* cheap check for squares */
+	y = mbin_sqrt_64(x);
+	if (y * y == x)
+		return (y);
+
+	for (c = 1; ; c++) {
+		f = mbin_factor_rho_64(x, c);
+		if (f != 0)
+			return (f);
+	}
+}
+
+static int
+mbin_factor_compare_64(const void *pa, const void *pb)
+{
+	uint64_t a = *(const uint64_t *)pa;
+	uint64_t b = *(const uint64_t *)pb;
+
+	return ((a > b) - (a < b));
+}
+
+/*
+ * Compute all prime factors of "x", with multiplicity and in
+ * increasing order. At most MBIN_FACTOR_MAX_64 factors are stored.
+ * Returns the number of factors.
+ */
+uint32_t
+mbin_factor_all_64(uint64_t x, uint64_t *pfact)
+{
+	uint64_t stack[MBIN_FACTOR_MAX_64];
+	uint32_t nstack = 0;
+	uint32_t num = 0;
+	uint64_t f;
+
+	if (x <= 1)
+		return (0);
+
+	while (!(x & 1)) {
+		pfact[num++] = 2;
+		x /= 2;
+	}
+
+	if (x != 1)
+		stack[nstack++] = x;
+
+	while (nstack != 0) {
+		x = stack[--nstack];
+		f = mbin_factor_fast_64(x);
+		if (f == 0) {
+			pfact[num++] = x;
+		} else {
+			stack[nstack++] = f;
+			stack[nstack++] = x / f;
+		}
+	}
+	qsort(pfact, num, sizeof(pfact[0]), &mbin_factor_compare_64);
+	return (num);
+}
+
+/*
+ * Factor "num" values. The factors of "px[i]" are stored starting at
+ * "pfact[i * MBIN_FACTOR_MAX_64]" and their count in "pnum[i]".
+ */
+void
+mbin_factor_array_64(const uint64_t *px, uint64_t *pfact, uint32_t *pnum,
+    size_t num)
+{
+	size_t i;
+
+	for (i = 0; i != num; i++)
+		pnum[i] = mbin_factor_all_64(px[i], pfact + i * MBIN_FACTOR_MAX_64);
+}
+
+struct mbin_factor_mt_64 {
+	const uint64_t *px;
+	uint64_t *pfact;
+	uint32_t *pnum;
+	size_t	num;
+};
+
+static void
+mbin_factor_mt_worker_64(void *arg, uint32_t index, uint32_t nthreads)
+{
+	struct mbin_factor_mt_64 *pmt = arg;
+	size_t i;
+
+	/* interleave the work, since the cost per value varies a lot */
+	for (i = index; i < pmt->num; i += nthreads) {
+		pmt->pnum[i] = mbin_factor_all_64(pmt->px[i],
+		    pmt->pfact + i * MBIN_FACTOR_MAX_64);
+	}
+}
+
+void
+mbin_factor_array_mt_64(const uint64_t *px, uint64_t *pfact, uint32_t *pnum,
+    size_t num, uint32_t nthreads)
+{
+	struct mbin_factor_mt_64 mt = {
+		.px = px,
+		.pfact = pfact,
+		.pnum = pnum,
+		.num = num,
+	};
+
+	if (nthreads > num)
+		nthreads = num;
+	if (nthreads <= 1)
+		mbin_factor_array_64(px, pfact, pnum, num);
+	else
+		mbin_thread_run(&mbin_factor_mt_worker_64, &mt, nthreads);
+}
@@ -0,0 +1,152 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Table driven conversion between base-2 and a small base-N, N from
+ * 2 to 8, where every base-N digit is stored in a fixed number of
+ * bits. Several digits are converted per table lookup. The results
+ * are the same as those of the per digit functions, like
+ * mbin_rebase_322_32() and mbin_rebase_223_32() for base 3, and the
+ * 5, 6 and 7 variants.
+ */
+
+#include <stdint.h>
+
+#include "math_bin.h"
+
+void
+mbin_rebase_init(struct mbin_rebase *pr, uint8_t base)
+{
+	uint32_t chunk;
+	uint32_t d;
+	uint32_t p;
+	uint32_t v;
+	uint32_t x;
+	uint8_t bits;
+	uint8_t y;
+
+	for (bits = 1; (1U << bits) < base; bits++)
+		;
+
+	pr->base = base;
+	pr->bits = bits;
+	pr->digits = 10 / bits;
+
+	for (chunk = 1, y = 0; y != pr->digits; y++)
+		chunk *= base;
+
+	/* reciprocal for dividing 32-bit values by "chunk" */
+	mbin_baseN_init_32(&pr->chunk, chunk);
+
+	/* packed digits to binary */
+	for (x = 0; x != (1U << (pr->digits * bits)); x++) {
+		v = 0;
+		d = 1;
+		for (y = 0; y != pr->digits; y++) {
+			p = (x >> (y * bits)) & ((1U << bits) - 1);
+			/* base-3 treats the invalid digit like two */
+			if (base == 3 && p == 3)
+				p = 2;
+			v += p * d;
+			d *= base;
+		}
+		pr->to2[x] = v;
+	}
+
+	/* binary to packed digits */
+	for (x = 0; x != chunk; x++) {
+		v = 0;
+		p = x;
+		for (y = 0; y != pr->digits; y++) {
+			v |= (p % base) << (y * bits);
+			p /= base;
+		}
+		pr->from2[x] = v;
+	}
+}
+
+uint32_t
+mbin_rebase_N22_32(const struct mbin_rebase *pr, uint32_t x)
+{
+	const uint8_t cb = pr->digits * pr->bits;
+	const uint32_t mask = (1U << cb) - 1;
+	uint32_t t = 0;
+	int8_t s;
+
+	for (s = (31 / cb) * cb; s >= 0; s -= cb)
+		t = (t * pr->chunk.n) + pr->to2[(x >> s) & mask];
+	return (t);
+}
+
+uint32_t
+mbin_rebase_22N_32(const struct mbin_rebase *pr, uint32_t x)
+{
+	const uint8_t max = 32 / pr->bits;
+	uint32_t t = 0;
+	uint32_t q;
+	uint8_t n;
+
+	for (n = 0; n + pr->digits <= max; n += pr->digits) {
+		q = mbin_baseN_div_32(&pr->chunk, x);
+		t |= (uint32_t)pr->from2[x - (q * pr->chunk.n)] << (n * pr->bits);
+		x = q;
+	}
+	for (; n != max; n++) {
+		t |= (x % pr->base) << (n * pr->bits);
+		x /= pr->base;
+	}
+	return (t);
+}
+
+uint64_t
+mbin_rebase_N22_64(const struct mbin_rebase *pr, uint64_t x)
+{
+	const uint8_t cb = pr->digits * pr->bits;
+	const uint64_t mask = (1ULL << cb) - 1;
+	uint64_t t = 0;
+	int8_t s;
+
+	for (s = (63 / cb) * cb; s >= 0; s -= cb)
+		t = (t * pr->chunk.n) + pr->to2[(x >> s) & mask];
+	return (t);
+}
+
+uint64_t
+mbin_rebase_22N_64(const struct mbin_rebase *pr, uint64_t x)
+{
+	const uint8_t max = 64 / pr->bits;
+	uint64_t t = 0;
+	uint8_t n;
+
+	for (n = 0; n + pr->digits <= max; n += pr->digits) {
+		t |= (uint64_t)pr->from2[x % pr->chunk.n] << (n * pr->bits);
+		x /= pr->chunk.n;
+	}
+	for (; n != max; n++) {
+		t |= (x % pr->base) << (n * pr->bits);
+		x /= pr->base;
+	}
+	return (t);
+}
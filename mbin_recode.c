@@ -23,7 +23,9 @@
  * SUCH DAMAGE.
  */
 
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "math_bin.h"
 
@@ -32,18 +34,10 @@ mbin_recodeA_fwd32(uint32_t val, const uint8_t *premap)
 {
 	uint32_t temp = 0;
 
+	/* only visit the bits which are set */
 	while (val) {
-		if (val & 1)
-			temp |= 1 << premap[0];
-		if (val & 2)
-			temp |= 1 << premap[1];
-		if (val & 4)
-			temp |= 1 << premap[2];
-		if (val & 8)
-			temp |= 1 << premap[3];
-
-		val >>= 4;
-		premap += 4;
+		temp |= 1U << premap[__builtin_ctz(val)];
+		val &= val - 1;
 	}
 	return (temp);
 }
@@ -162,3 +156,167 @@ mbin_recodeB_inv32(uint32_t val, const uint32_t *ptr)
 	}
 	return (x);
 }
+
+/*
+ * Compiled recode plans. A permutation which is used many times is
+ * analysed once and turned into the cheapest of:
+ *
+ * MBIN_RECODE_SHIFT: the bits are grouped by the distance they move,
+ * one masked shift per distinct distance.
+ *
+ * MBIN_RECODE_TABLE: four byte tables, one lookup per input byte.
+ *
+ * MBIN_RECODE_ADD: for recodeB, one masked addition per distinct
+ * addend, where addends only need to agree in the bits that matter.
+ */
+#define	MBIN_RECODE_SHIFT_MAX 6
+
+void
+mbin_recodeA_compile(struct mbin_recode_plan *plan, const uint8_t *premap)
+{
+	uint32_t x;
+	uint8_t n;
+	uint8_t y;
+	int8_t d;
+
+	memset(plan, 0, sizeof(*plan));
+
+	for (x = 0; x != 32; x++) {
+		if (premap[x] >= 32)
+			continue;
+		d = (int8_t)premap[x] - (int8_t)x;
+
+		for (y = 0; y != plan->count; y++) {
+			if (plan->shift[y] == d)
+				break;
+		}
+		if (y == plan->count) {
+			if (y == MBIN_RECODE_SHIFT_MAX)
+				break;
+			plan->shift[y] = d;
+			plan->count++;
+		}
+		plan->mask[y] |= 1U << x;
+	}
+
+	if (x == 32) {
+		plan->type = MBIN_RECODE_SHIFT;
+		return;
+	}
+
+	plan->type = MBIN_RECODE_TABLE;
+	plan->count = 0;
+
+	for (n = 0; n != 4; n++) {
+		for (x = 0; x != 256; x++) {
+			plan->table[n][x] =
+			    mbin_recodeA_fwd32(x << (8 * n), premap);
+		}
+	}
+}
+
+void
+mbin_recodeB_compile(struct mbin_recode_plan *plan, const uint32_t *ptr)
+{
+	uint32_t m;
+	int8_t x;
+	uint8_t y;
+
+	memset(plan, 0, sizeof(*plan));
+
+	plan->type = MBIN_RECODE_ADD;
+
+	/*
+	 * Bit "x" of the result only depends on the lower "x + 1"
+	 * bits of the addend. Going from the top bit, reuse an
+	 * addend which agrees in those bits.
+	 */
+	for (x = 31; x >= 0; x--) {
+		m = (2U << x) - 1;
+
+		for (y = 0; y != plan->count; y++) {
+			if (((plan->value[y] ^ ptr[x]) & m) == 0)
+				break;
+		}
+		if (y == plan->count) {
+			plan->value[y] = ptr[x];
+			plan->count++;
+		}
+		plan->mask[y] |= 1U << x;
+	}
+}
+
+uint32_t
+mbin_recode_fwd32(const struct mbin_recode_plan *plan, uint32_t x)
+{
+	uint32_t temp = 0;
+	uint8_t y;
+
+	switch (plan->type) {
+	case MBIN_RECODE_SHIFT:
+		for (y = 0; y != plan->count; y++) {
+			if (plan->shift[y] >= 0)
+				temp |= (x & plan->mask[y]) << plan->shift[y];
+			else
+				temp |= (x & plan->mask[y]) >> -plan->shift[y];
+		}
+		break;
+	case MBIN_RECODE_TABLE:
+		temp = plan->table[0][x & 0xFF] |
+		    plan->table[1][(x >> 8) & 0xFF] |
+		    plan->table[2][(x >> 16) & 0xFF] |
+		    plan->table[3][x >> 24];
+		break;
+	default:
+		for (y = 0; y != plan->count; y++)
+			temp |= (x + plan->value[y]) & plan->mask[y];
+		break;
+	}
+	return (temp);
+}
+
+void
+mbin_recode_apply(const struct mbin_recode_plan *plan,
+    const uint32_t *src, uint32_t *dst, size_t num)
+{
+	uint32_t temp;
+	size_t x;
+	uint8_t y;
+
+	/* "src" and "dst" may be the same array */
+	switch (plan->type) {
+	case MBIN_RECODE_SHIFT:
+		for (x = 0; x != num; x++) {
+			const uint32_t val = src[x];
+
+			temp = 0;
+			for (y = 0; y != plan->count; y++) {
+				if (plan->shift[y] >= 0)
+					temp |= (val & plan->mask[y]) << plan->shift[y];
+				else
+					temp |= (val & plan->mask[y]) >> -plan->shift[y];
+			}
+			dst[x] = temp;
+		}
+		break;
+	case MBIN_RECODE_TABLE:
+		for (x = 0; x != num; x++) {
+			temp = src[x];
+			dst[x] = plan->table[0][temp & 0xFF] |
+			    plan->table[1][(temp >> 8) & 0xFF] |
+			    plan->table[2][(temp >> 16) & 0xFF] |
+			    plan->table[3][temp >> 24];
+		}
+		break;
+	default:
+		for (x = 0; x != num; x++) {
+			const uint32_t val = src[x];
+
+			temp = 0;
+			for (y = 0; y != plan->count; y++)
+				temp |= (val + plan->value[y]) & plan->mask[y];
+			dst[x] = temp;
+		}
+		break;
+	}
+}
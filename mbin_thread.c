@@ -0,0 +1,79 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "math_bin.h"
+
+struct mbin_thread_job {
+	pthread_t thread;
+	mbin_thread_fn_t *fn;
+	void   *arg;
+	uint32_t index;
+	uint32_t num;
+};
+
+static void *
+mbin_thread_entry(void *arg)
+{
+	struct mbin_thread_job *pjob = arg;
+
+	pjob->fn(pjob->arg, pjob->index, pjob->num);
+	return (NULL);
+}
+
+/*
+ * Call "fn" once for every index from 0 to "num" - 1, using one
+ * thread per index. Index zero is run by the calling thread. If a
+ * thread cannot be created, the work is done by the calling thread
+ * instead. This function returns when all work is complete.
+ */
+void
+mbin_thread_run(mbin_thread_fn_t *fn, void *arg, uint32_t num)
+{
+	struct mbin_thread_job job[num ? num : 1];
+	uint8_t started[num ? num : 1];
+	uint32_t x;
+
+	for (x = 1; x < num; x++) {
+		job[x].fn = fn;
+		job[x].arg = arg;
+		job[x].index = x;
+		job[x].num = num;
+		started[x] = (pthread_create(&job[x].thread, NULL,
+		    &mbin_thread_entry, &job[x]) == 0);
+	}
+
+	if (num != 0)
+		fn(arg, 0, num);
+
+	for (x = 1; x < num; x++) {
+		if (started[x])
+			pthread_join(job[x].thread, NULL);
+		else
+			fn(arg, x, num);
+	}
+}
@@ -32,13 +32,239 @@
 
 #include "math_bin_complex.h"
 
+/*
+ * Radix-2 transform engine.
+ *
+ * All the radix-2 transforms below have the same structure, and only
+ * differ by the butterfly. The engine first does all stages which fit
+ * inside an L1 sized block, block by block, and then the remaining
+ * stages three at a time, so that a transform of 2**N elements needs
+ * about (N - log2(block)) / 3 + 1 passes over memory instead of N.
+ * The inner loops are stride-1 and vectorise. Every element sees the
+ * same operations in the same order as in the plain triple loop, so
+ * the results are bit exact. The "lo" argument gives the first stage,
+ * which is used to transform complex numbers as pairs of doubles.
+ */
+#define	MBIN_XFORM2_BLOCK (1UL << 14)	/* bytes */
+
+#define	MBIN_XFORM2_WHT 0
+#define	MBIN_XFORM2_FWD_ADD 1
+#define	MBIN_XFORM2_INV_ADD 2
+#define	MBIN_XFORM2_FWD_REV 3
+#define	MBIN_XFORM2_INV_REV 4
+#define	MBIN_XFORM2_XOR 5
+
+/*
+ * The engine is the same for every element type, given the matching
+ * butterfly function.
+ */
+#define	MBIN_XFORM2_ENGINE(name, type, bfly) \
+static __always_inline void \
+name(type *ptr, const size_t max, const size_t lo, const int op) \
+{ \
+	size_t blk = MBIN_XFORM2_BLOCK / sizeof(ptr[0]); \
+	size_t h; \
+	size_t x; \
+	size_t y; \
+	size_t z; \
+\
+	if (blk > max) \
+		blk = max; \
+\
+	/* do all the stages which fit inside a block, block by block */ \
+	for (x = 0; x != max; x += blk) { \
+		type *p = ptr + x; \
+\
+		for (h = lo; h < blk; h *= 2) { \
+			for (y = 0; y != blk; y += 2 * h) { \
+				for (z = y; z != y + h; z++) \
+					bfly(p + z, p + z + h, op); \
+			} \
+		} \
+	} \
+\
+	/* do the remaining stages, up to three per pass */ \
+	for (h = blk; h < max; ) { \
+		if (8 * h <= max) { \
+			for (y = 0; y != max; y += 8 * h) { \
+				type *p = ptr + y; \
+\
+				for (z = 0; z != h; z++) { \
+					type a[8]; \
+\
+					for (x = 0; x != 8; x++) \
+						a[x] = p[z + x * h]; \
+					for (x = 0; x != 8; x += 2) \
+						bfly(a + x, a + x + 1, op); \
+					for (x = 0; x != 8; x += (x & 1) ? 3 : 1) \
+						bfly(a + x, a + x + 2, op); \
+					for (x = 0; x != 4; x++) \
+						bfly(a + x, a + x + 4, op); \
+					for (x = 0; x != 8; x++) \
+						p[z + x * h] = a[x]; \
+				} \
+			} \
+			h *= 8; \
+		} else if (4 * h <= max) { \
+			for (y = 0; y != max; y += 4 * h) { \
+				type *p = ptr + y; \
+\
+				for (z = 0; z != h; z++) { \
+					type a[4]; \
+\
+					for (x = 0; x != 4; x++) \
+						a[x] = p[z + x * h]; \
+					bfly(a + 0, a + 1, op); \
+					bfly(a + 2, a + 3, op); \
+					bfly(a + 0, a + 2, op); \
+					bfly(a + 1, a + 3, op); \
+					for (x = 0; x != 4; x++) \
+						p[z + x * h] = a[x]; \
+				} \
+			} \
+			h *= 4; \
+		} else { \
+			for (z = 0; z != h; z++) \
+				bfly(ptr + z, ptr + z + h, op); \
+			h *= 2; \
+		} \
+	} \
+}
+
+static __always_inline void
+mbin_xform2_bfly_32(uint32_t *pa, uint32_t *pb, const int op)
+{
+	const uint32_t a = *pa;
+	const uint32_t b = *pb;
+
+	switch (op) {
+	case MBIN_XFORM2_WHT:
+		*pa = a + b;
+		*pb = a - b;
+		break;
+	case MBIN_XFORM2_FWD_ADD:
+		*pb = a + b;
+		break;
+	case MBIN_XFORM2_INV_ADD:
+		*pb = b - a;
+		break;
+	case MBIN_XFORM2_FWD_REV:
+		*pa = a + b;
+		break;
+	case MBIN_XFORM2_INV_REV:
+		*pa = a - b;
+		break;
+	case MBIN_XFORM2_XOR:
+		*pb = a ^ b;
+		break;
+	default:
+		break;
+	}
+}
+
+static __always_inline void
+mbin_xform2_bfly_64(uint64_t *pa, uint64_t *pb, const int op)
+{
+	const uint64_t a = *pa;
+	const uint64_t b = *pb;
+
+	switch (op) {
+	case MBIN_XFORM2_WHT:
+		*pa = a + b;
+		*pb = a - b;
+		break;
+	case MBIN_XFORM2_FWD_ADD:
+		*pb = a + b;
+		break;
+	case MBIN_XFORM2_INV_ADD:
+		*pb = b - a;
+		break;
+	case MBIN_XFORM2_FWD_REV:
+		*pa = a + b;
+		break;
+	case MBIN_XFORM2_INV_REV:
+		*pa = a - b;
+		break;
+	case MBIN_XFORM2_XOR:
+		*pb = a ^ b;
+		break;
+	default:
+		break;
+	}
+}
+
+static __always_inline void
+mbin_xform2_bfly_double(double *pa, double *pb, const int op)
+{
+	const double a = *pa;
+	const double b = *pb;
+
+	switch (op) {
+	case MBIN_XFORM2_WHT:
+		*pa = a + b;
+		*pb = a - b;
+		break;
+	case MBIN_XFORM2_FWD_ADD:
+		*pb = a + b;
+		break;
+	case MBIN_XFORM2_INV_ADD:
+		*pb = b - a;
+		break;
+	case MBIN_XFORM2_FWD_REV:
+		*pa = a + b;
+		break;
+	case MBIN_XFORM2_INV_REV:
+		*pa = a - b;
+		break;
+	default:
+		break;
+	}
+}
+
+MBIN_XFORM2_ENGINE(mbin_xform2_engine_32, uint32_t, mbin_xform2_bfly_32)
+MBIN_XFORM2_ENGINE(mbin_xform2_engine_64, uint64_t, mbin_xform2_bfly_64)
+MBIN_XFORM2_ENGINE(mbin_xform2_engine_double, double, mbin_xform2_bfly_double)
+
+/*
+ * Returns the number of bits in "mask" if it is a power of two
+ * minus one, else -1. Tables having such a mask can use the
+ * O(N * log2(N)) butterfly transforms below.
+ */
+static int
+mbin_transform_log2_mask(uint32_t mask)
+{
+	if (mask == -1U || (mask & (mask + 1)) != 0)
+		return (-1);
+	return (mbin_sumbits32(mask));
+}
+
 /* XOR - transform */
 
 void
 mbin_transform_xor_fwd_32x32(uint32_t *ptr, uint32_t mask,
     uint32_t f_slice, uint32_t t_slice)
 {
+	const int log2_max = mbin_transform_log2_mask(mask);
 	uint32_t x;
+	uint32_t y;
+	uint32_t z;
+
+	if (log2_max >= 0 && (f_slice & t_slice) == 0) {
+		const uint32_t max = mask + 1;
+
+		for (x = 0; x != max; x++) {
+			ptr[x] &= ~t_slice;
+			if (ptr[x] & f_slice)
+				ptr[x] |= t_slice;
+		}
+		for (x = 2; x <= max; x *= 2) {
+			for (y = 0; y != max; y += x) {
+				for (z = 0; z != (x / 2); z++)
+					ptr[y + z + (x / 2)] ^= ptr[y + z] & t_slice;
+			}
+		}
+		return;
+	}
 
 	/* cleanup "t_slice" */
 	x = 0;
@@ -66,9 +292,16 @@ void
 mbin_transform_multi_xor_fwd_32x32(uint32_t *ptr, uint32_t *temp,
     uint32_t mask)
 {
+	const int log2_max = mbin_transform_log2_mask(mask);
 	uint32_t x;
 	uint32_t val;
 
+	if (log2_max >= 0) {
+		memcpy(temp, ptr, sizeof(temp[0]) * (mask + 1));
+		mbin_xor_xform_32(temp, log2_max);
+		return;
+	}
+
 	/* cleanup "t_slice" */
 	x = 0;
 	while (1) {
@@ -100,9 +333,16 @@ void
 mbin_transform_add_fwd_32x32(uint32_t *ptr, uint32_t *temp,
     uint32_t mask)
 {
+	const int log2_max = mbin_transform_log2_mask(mask);
 	uint32_t x;
 	uint32_t val;
 
+	if (log2_max >= 0) {
+		memcpy(temp, ptr, sizeof(temp[0]) * (mask + 1));
+		mbin_inverse_add_xform_32(temp, log2_max);
+		return;
+	}
+
 	/* cleanup "t_slice" */
 	x = 0;
 	while (1) {
@@ -168,9 +408,16 @@ void
 mbin_transform_gte_fwd_32x32(uint32_t *ptr, uint32_t *temp,
     uint32_t mask)
 {
+	const int log2_max = mbin_transform_log2_mask(mask);
 	uint32_t x;
 	uint32_t val;
 
+	if (log2_max >= 0) {
+		memcpy(temp, ptr, sizeof(temp[0]) * (mask + 1));
+		mbin_inverse_gte_mask_xform_32(temp, log2_max);
+		return;
+	}
+
 	/* cleanup "t_slice" */
 	x = 0;
 	while (1) {
@@ -200,9 +447,16 @@ void
 mbin_transform_xor_gte_fwd_32x32(uint32_t *ptr, uint32_t *temp,
     uint32_t mask)
 {
+	const int log2_max = mbin_transform_log2_mask(mask);
 	uint32_t x;
 	uint32_t val;
 
+	if (log2_max >= 0) {
+		memcpy(temp, ptr, sizeof(temp[0]) * (mask + 1));
+		mbin_xor2_inv_gte_mask_xform_32(temp, log2_max);
+		return;
+	}
+
 	/* cleanup "t_slice" */
 	x = 0;
 	while (1) {
@@ -724,22 +978,7 @@ mbin_xor2_inv_gte_mask_xform_32(uint32_t *ptr, uint8_t log2_max)
 void
 mbin_inverse_add_xform_32(uint32_t *ptr, uint8_t log2_max)
 {
-	const uint32_t max = 1U << log2_max;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	int32_t a;
-	int32_t b;
-
-	for (x = 2; x <= max; x *= 2) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 2); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 2)];
-				ptr[y + z + (x / 2)] = b - a;
-			}
-		}
-	}
+	mbin_xform2_engine_32(ptr, 1UL << log2_max, 1, MBIN_XFORM2_INV_ADD);
 }
 
 /*
@@ -750,134 +989,564 @@ mbin_inverse_add_xform_32(uint32_t *ptr, uint8_t log2_max)
 void
 mbin_forward_add_xform_32(uint32_t *ptr, uint8_t log2_max)
 {
-	const uint32_t max = 1U << log2_max;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	int32_t a;
-	int32_t b;
+	mbin_xform2_engine_32(ptr, 1UL << log2_max, 1, MBIN_XFORM2_FWD_ADD);
+}
 
-	for (x = 2; x <= max; x *= 2) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 2); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 2)];
-				ptr[y + z + (x / 2)] = a + b;
-			}
+/*
+ * Radix-3 transforms
+ */
+#define	MBIN_XFORM3_MT_MIN (1UL << 16)	/* elements per thread */
+#define	MBIN_XFORM3_TILE 256		/* columns */
+
+#define	MBIN_XFORM3_FWD_ADD 0
+#define	MBIN_XFORM3_INV_ADD 1
+#define	MBIN_XFORM3_FWD_XOR2 2
+#define	MBIN_XFORM3_INV_XOR2 3
+#define	MBIN_XFORM3_FWD 4
+#define	MBIN_XFORM3_INV 5
+#define	MBIN_XFORM3_ALT_FWD 6
+#define	MBIN_XFORM3_ALT_INV 7
+
+static __always_inline void
+mbin_xform3_bfly_32(uint32_t *pa, uint32_t *pb, uint32_t *pc, const int op)
+{
+	const uint32_t a = *pa;
+	const uint32_t b = *pb;
+	const uint32_t c = *pc;
+
+	switch (op) {
+	case MBIN_XFORM3_FWD_ADD:
+		*pb = a + b + c;
+		*pc = a + (2 * b) + c;
+		break;
+	case MBIN_XFORM3_INV_ADD:
+		*pb = c - b;
+		*pc = (2 * b) - c - a;
+		break;
+	case MBIN_XFORM3_FWD_XOR2:
+		*pb = a ^ b ^ c;
+		*pc = a ^ c;
+		break;
+	case MBIN_XFORM3_INV_XOR2:
+		*pb = c ^ b;
+		*pc = c ^ a;
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * Do all the stages of a radix-3 transform which fit inside the
+ * block "p" of "blk" elements.
+ */
+static __always_inline void
+mbin_xform3_block_32(uint32_t *p, const size_t blk, const int op)
+{
+	size_t h;
+	size_t y;
+	size_t z;
+
+	for (h = 1; h < blk; h *= 3) {
+		for (y = 0; y != blk; y += 3 * h) {
+			for (z = y; z != y + h; z++)
+				mbin_xform3_bfly_32(p + z, p + z + h, p + z + 2 * h, op);
 		}
 	}
 }
 
 /*
- * Inverse additive transform (r3).
+ * Do one pass over the columns from "start" to "stop" at stage "h",
+ * doing one stage if "radix" is 3 and two stages if "radix" is 9.
+ * Column "c" starts at element ((c / h) * radix * h) + (c % h).
  */
-void
-mbin_inverse_r3_add_xform_32(uint32_t *ptr, uint8_t log3_max)
+static __always_inline void
+mbin_xform3_pass_32(uint32_t *ptr, const size_t h, const size_t radix,
+    size_t start, const size_t stop, const int op)
+{
+	uint32_t *p;
+	uint32_t *q;
+	size_t e;
+	size_t n;
+	size_t t;
+	size_t w;
+	size_t x;
+	size_t z;
+
+	while (start != stop) {
+		z = start % h;
+		n = h - z;
+		if (n > stop - start)
+			n = stop - start;
+		p = ptr + ((start - z) * radix) + z;
+
+		if (radix == 9) {
+			/* keep the nine rows of a tile in the L1 cache */
+			for (t = 0; t < n; t += MBIN_XFORM3_TILE) {
+				e = n - t;
+				if (e > MBIN_XFORM3_TILE)
+					e = MBIN_XFORM3_TILE;
+				for (x = 0; x != 9; x += 3) {
+					q = p + t + x * h;
+					for (w = 0; w != e; w++)
+						mbin_xform3_bfly_32(q + w, q + w + h, q + w + 2 * h, op);
+				}
+				for (x = 0; x != 3; x++) {
+					q = p + t + x * h;
+					for (w = 0; w != e; w++)
+						mbin_xform3_bfly_32(q + w, q + w + 3 * h, q + w + 6 * h, op);
+				}
+			}
+		} else {
+			for (w = 0; w != n; w++)
+				mbin_xform3_bfly_32(p + w, p + w + h, p + w + 2 * h, op);
+		}
+		start += n;
+	}
+}
+
+struct mbin_xform3_mt_32 {
+	uint32_t *ptr;
+	size_t	max;
+	size_t	blk;
+	size_t	h;
+	size_t	radix;
+	int	op;
+};
+
+static void
+mbin_xform3_mt_worker_32(void *arg, uint32_t index, uint32_t num)
 {
-	const uint32_t max = mbin_power_64(3, log3_max);
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	int32_t a;
-	int32_t b;
-	int32_t c;
+	struct mbin_xform3_mt_32 *pxf = arg;
+	size_t start;
+	size_t stop;
 
-	for (x = 3; x <= max; x *= 3) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 3); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 3)];
-				c = ptr[y + z + 2 * (x / 3)];
+	if (pxf->h == 0) {
+		/* in-block stages, one range of blocks per thread */
+		const size_t nblk = pxf->max / pxf->blk;
+
+		start = (nblk * index) / num;
+		stop = (nblk * (index + 1)) / num;
 
-				ptr[y + z + (x / 3)] = c - b;
-				ptr[y + z + 2 * (x / 3)] = (2 * b) - c - a;
+		for (; start != stop; start++) {
+			uint32_t *p = pxf->ptr + (start * pxf->blk);
+
+			switch (pxf->op) {
+			case MBIN_XFORM3_FWD_ADD:
+				mbin_xform3_block_32(p, pxf->blk, MBIN_XFORM3_FWD_ADD);
+				break;
+			case MBIN_XFORM3_INV_ADD:
+				mbin_xform3_block_32(p, pxf->blk, MBIN_XFORM3_INV_ADD);
+				break;
+			case MBIN_XFORM3_FWD_XOR2:
+				mbin_xform3_block_32(p, pxf->blk, MBIN_XFORM3_FWD_XOR2);
+				break;
+			default:
+				mbin_xform3_block_32(p, pxf->blk, MBIN_XFORM3_INV_XOR2);
+				break;
 			}
 		}
+	} else {
+		/* outer stages, one range of columns per thread */
+		const size_t cols = pxf->max / pxf->radix;
+
+		start = (cols * index) / num;
+		stop = (cols * (index + 1)) / num;
+
+		switch (pxf->op) {
+		case MBIN_XFORM3_FWD_ADD:
+			mbin_xform3_pass_32(pxf->ptr, pxf->h, pxf->radix,
+			    start, stop, MBIN_XFORM3_FWD_ADD);
+			break;
+		case MBIN_XFORM3_INV_ADD:
+			mbin_xform3_pass_32(pxf->ptr, pxf->h, pxf->radix,
+			    start, stop, MBIN_XFORM3_INV_ADD);
+			break;
+		case MBIN_XFORM3_FWD_XOR2:
+			mbin_xform3_pass_32(pxf->ptr, pxf->h, pxf->radix,
+			    start, stop, MBIN_XFORM3_FWD_XOR2);
+			break;
+		default:
+			mbin_xform3_pass_32(pxf->ptr, pxf->h, pxf->radix,
+			    start, stop, MBIN_XFORM3_INV_XOR2);
+			break;
+		}
 	}
 }
 
 /*
- * Forward additive transform (r3).
+ * Radix-3 transform engine for 3**N elements. Like the radix-2
+ * engine above, all stages which fit inside an L1 sized block are
+ * done block by block, and the remaining stages two at a time, so
+ * that strided accesses are few and every element sees the same
+ * operations in the same order as in the plain triple loop. The
+ * passes are split among "nthreads" threads when the array is large.
  */
-void
-mbin_forward_r3_add_xform_32(uint32_t *ptr, uint8_t log3_max)
+static void
+mbin_xform3_engine_32(uint32_t *ptr, const size_t max, uint32_t nthreads, const int op)
+{
+	struct mbin_xform3_mt_32 xf;
+	size_t blk;
+	uint32_t num;
+
+	for (blk = 1; 3 * blk * sizeof(ptr[0]) <= MBIN_XFORM2_BLOCK &&
+	    3 * blk <= max; blk *= 3)
+		;
+
+	xf.ptr = ptr;
+	xf.max = max;
+	xf.blk = blk;
+	xf.op = op;
+
+	num = nthreads;
+	if (num > max / MBIN_XFORM3_MT_MIN)
+		num = max / MBIN_XFORM3_MT_MIN;
+	if (num < 1)
+		num = 1;
+
+	xf.h = 0;
+	xf.radix = 3;
+	if (num == 1)
+		mbin_xform3_mt_worker_32(&xf, 0, 1);
+	else
+		mbin_thread_run(&mbin_xform3_mt_worker_32, &xf, num);
+
+	for (xf.h = blk; xf.h < max; xf.h *= xf.radix) {
+		xf.radix = (9 * xf.h <= max) ? 9 : 3;
+		if (num == 1)
+			mbin_xform3_mt_worker_32(&xf, 0, 1);
+		else
+			mbin_thread_run(&mbin_xform3_mt_worker_32, &xf, num);
+	}
+}
+
+static __always_inline void
+mbin_xform3_bfly_double(double *pa, double *pb, double *pc, const int op)
+{
+	const double a = *pa;
+	const double b = *pb;
+	const double c = *pc;
+
+	switch (op) {
+	case MBIN_XFORM3_FWD:
+		*pb = (c + a) + b;
+		*pc = (c + a) - b;
+		break;
+	case MBIN_XFORM3_INV:
+		*pb = ((b - a) - (c - a)) / 2;
+		*pc = ((b - a) + (c - a)) / 2;
+		break;
+	case MBIN_XFORM3_ALT_FWD:
+		*pa = (a + b);
+		*pb = (a + c);
+		*pc = (b + c);
+		break;
+	case MBIN_XFORM3_ALT_INV:
+		*pa = (a + b - c) / 2.0;
+		*pb = (a + c - b) / 2.0;
+		*pc = (b + c - a) / 2.0;
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * Do all the stages of a radix-3 transform which fit inside the
+ * block "p" of "blk" elements.
+ */
+static __always_inline void
+mbin_xform3_block_double(double *p, const size_t blk, const int op)
 {
-	const uint32_t max = mbin_power_64(3, log3_max);
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	int32_t a;
-	int32_t b;
-	int32_t c;
+	size_t h;
+	size_t y;
+	size_t z;
 
-	for (x = 3; x <= max; x *= 3) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 3); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 3)];
-				c = ptr[y + z + 2 * (x / 3)];
+	for (h = 1; h < blk; h *= 3) {
+		for (y = 0; y != blk; y += 3 * h) {
+			for (z = y; z != y + h; z++)
+				mbin_xform3_bfly_double(p + z, p + z + h, p + z + 2 * h, op);
+		}
+	}
+}
+
+/*
+ * Do one pass over the columns from "start" to "stop" at stage "h",
+ * doing one stage if "radix" is 3 and two stages if "radix" is 9.
+ * Column "c" starts at element ((c / h) * radix * h) + (c % h).
+ */
+static __always_inline void
+mbin_xform3_pass_double(double *ptr, const size_t h, const size_t radix,
+    size_t start, const size_t stop, const int op)
+{
+	double *p;
+	double *q;
+	size_t e;
+	size_t n;
+	size_t t;
+	size_t w;
+	size_t x;
+	size_t z;
+
+	while (start != stop) {
+		z = start % h;
+		n = h - z;
+		if (n > stop - start)
+			n = stop - start;
+		p = ptr + ((start - z) * radix) + z;
+
+		if (radix == 9) {
+			/* keep the nine rows of a tile in the L1 cache */
+			for (t = 0; t < n; t += MBIN_XFORM3_TILE) {
+				e = n - t;
+				if (e > MBIN_XFORM3_TILE)
+					e = MBIN_XFORM3_TILE;
+				for (x = 0; x != 9; x += 3) {
+					q = p + t + x * h;
+					for (w = 0; w != e; w++)
+						mbin_xform3_bfly_double(q + w, q + w + h, q + w + 2 * h, op);
+				}
+				for (x = 0; x != 3; x++) {
+					q = p + t + x * h;
+					for (w = 0; w != e; w++)
+						mbin_xform3_bfly_double(q + w, q + w + 3 * h, q + w + 6 * h, op);
+				}
+			}
+		} else {
+			for (w = 0; w != n; w++)
+				mbin_xform3_bfly_double(p + w, p + w + h, p + w + 2 * h, op);
+		}
+		start += n;
+	}
+}
+
+struct mbin_xform3_mt_double {
+	double *ptr;
+	size_t	max;
+	size_t	blk;
+	size_t	h;
+	size_t	radix;
+	int	op;
+};
+
+static void
+mbin_xform3_mt_worker_double(void *arg, uint32_t index, uint32_t num)
+{
+	struct mbin_xform3_mt_double *pxf = arg;
+	size_t start;
+	size_t stop;
+
+	if (pxf->h == 0) {
+		/* in-block stages, one range of blocks per thread */
+		const size_t nblk = pxf->max / pxf->blk;
+
+		start = (nblk * index) / num;
+		stop = (nblk * (index + 1)) / num;
+
+		for (; start != stop; start++) {
+			double *p = pxf->ptr + (start * pxf->blk);
 
-				ptr[y + z + (x / 3)] = a + b + c;
-				ptr[y + z + 2 * (x / 3)] = a + (2 * b) + c;
+			switch (pxf->op) {
+			case MBIN_XFORM3_FWD:
+				mbin_xform3_block_double(p, pxf->blk, MBIN_XFORM3_FWD);
+				break;
+			case MBIN_XFORM3_INV:
+				mbin_xform3_block_double(p, pxf->blk, MBIN_XFORM3_INV);
+				break;
+			case MBIN_XFORM3_ALT_FWD:
+				mbin_xform3_block_double(p, pxf->blk, MBIN_XFORM3_ALT_FWD);
+				break;
+			default:
+				mbin_xform3_block_double(p, pxf->blk, MBIN_XFORM3_ALT_INV);
+				break;
 			}
 		}
+	} else {
+		/* outer stages, one range of columns per thread */
+		const size_t cols = pxf->max / pxf->radix;
+
+		start = (cols * index) / num;
+		stop = (cols * (index + 1)) / num;
+
+		switch (pxf->op) {
+		case MBIN_XFORM3_FWD:
+			mbin_xform3_pass_double(pxf->ptr, pxf->h, pxf->radix,
+			    start, stop, MBIN_XFORM3_FWD);
+			break;
+		case MBIN_XFORM3_INV:
+			mbin_xform3_pass_double(pxf->ptr, pxf->h, pxf->radix,
+			    start, stop, MBIN_XFORM3_INV);
+			break;
+		case MBIN_XFORM3_ALT_FWD:
+			mbin_xform3_pass_double(pxf->ptr, pxf->h, pxf->radix,
+			    start, stop, MBIN_XFORM3_ALT_FWD);
+			break;
+		default:
+			mbin_xform3_pass_double(pxf->ptr, pxf->h, pxf->radix,
+			    start, stop, MBIN_XFORM3_ALT_INV);
+			break;
+		}
 	}
 }
 
 /*
- * Inverse exclusive or transform (r3).
+ * Radix-3 transform engine for 3**N elements. Like the radix-2
+ * engine above, all stages which fit inside an L1 sized block are
+ * done block by block, and the remaining stages two at a time, so
+ * that strided accesses are few and every element sees the same
+ * operations in the same order as in the plain triple loop. The
+ * passes are split among "nthreads" threads when the array is large.
+ */
+static void
+mbin_xform3_engine_double(double *ptr, const size_t max, uint32_t nthreads, const int op)
+{
+	struct mbin_xform3_mt_double xf;
+	size_t blk;
+	uint32_t num;
+
+	for (blk = 1; 3 * blk * sizeof(ptr[0]) <= MBIN_XFORM2_BLOCK &&
+	    3 * blk <= max; blk *= 3)
+		;
+
+	xf.ptr = ptr;
+	xf.max = max;
+	xf.blk = blk;
+	xf.op = op;
+
+	num = nthreads;
+	if (num > max / MBIN_XFORM3_MT_MIN)
+		num = max / MBIN_XFORM3_MT_MIN;
+	if (num < 1)
+		num = 1;
+
+	xf.h = 0;
+	xf.radix = 3;
+	if (num == 1)
+		mbin_xform3_mt_worker_double(&xf, 0, 1);
+	else
+		mbin_thread_run(&mbin_xform3_mt_worker_double, &xf, num);
+
+	for (xf.h = blk; xf.h < max; xf.h *= xf.radix) {
+		xf.radix = (9 * xf.h <= max) ? 9 : 3;
+		if (num == 1)
+			mbin_xform3_mt_worker_double(&xf, 0, 1);
+		else
+			mbin_thread_run(&mbin_xform3_mt_worker_double, &xf, num);
+	}
+}
+
+/*
+ * Digit reverse the index of the elements of an array of 3**N
+ * elements, in place. This is the radix-3 equivalent of the bit
+ * reversal done before or after an in place FFT.
  */
+static size_t
+mbin_digitrev3_next(size_t r, size_t max)
+{
+	size_t p;
+
+	for (p = max / 3; p != 0; p /= 3) {
+		if ((r / p) % 3 != 2)
+			return (r + p);
+		r -= 2 * p;
+	}
+	return (r);
+}
+
 void
-mbin_inverse_r3_xor2_xform_32(uint32_t *ptr, uint8_t log3_max)
+mbin_digitrev3_32(uint32_t *ptr, uint8_t log3_max)
 {
-	const uint32_t max = mbin_power_64(3, log3_max);
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	int32_t a;
-	int32_t b;
-	int32_t c;
+	const size_t max = mbin_power_64(3, log3_max);
+	uint32_t t;
+	size_t r;
+	size_t x;
 
-	for (x = 3; x <= max; x *= 3) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 3); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 3)];
-				c = ptr[y + z + 2 * (x / 3)];
+	for (x = r = 0; x != max; x++) {
+		if (x < r) {
+			t = ptr[x];
+			ptr[x] = ptr[r];
+			ptr[r] = t;
+		}
+		r = mbin_digitrev3_next(r, max);
+	}
+}
 
-				ptr[y + z + (x / 3)] = c ^ b;
-				ptr[y + z + 2 * (x / 3)] = c ^ a;
-			}
+void
+mbin_digitrev3_double(double *ptr, uint8_t log3_max)
+{
+	const size_t max = mbin_power_64(3, log3_max);
+	double t;
+	size_t r;
+	size_t x;
+
+	for (x = r = 0; x != max; x++) {
+		if (x < r) {
+			t = ptr[x];
+			ptr[x] = ptr[r];
+			ptr[r] = t;
 		}
+		r = mbin_digitrev3_next(r, max);
 	}
 }
 
+/*
+ * Inverse additive transform (r3).
+ */
+void
+mbin_inverse_r3_add_xform_32(uint32_t *ptr, uint8_t log3_max)
+{
+	mbin_xform3_engine_32(ptr, (uint32_t)mbin_power_64(3, log3_max), 1, MBIN_XFORM3_INV_ADD);
+}
+
+void
+mbin_inverse_r3_add_xform_mt_32(uint32_t *ptr, uint8_t log3_max, uint32_t nthreads)
+{
+	mbin_xform3_engine_32(ptr, (uint32_t)mbin_power_64(3, log3_max), nthreads, MBIN_XFORM3_INV_ADD);
+}
+
+/*
+ * Forward additive transform (r3).
+ */
+void
+mbin_forward_r3_add_xform_32(uint32_t *ptr, uint8_t log3_max)
+{
+	mbin_xform3_engine_32(ptr, (uint32_t)mbin_power_64(3, log3_max), 1, MBIN_XFORM3_FWD_ADD);
+}
+
+void
+mbin_forward_r3_add_xform_mt_32(uint32_t *ptr, uint8_t log3_max, uint32_t nthreads)
+{
+	mbin_xform3_engine_32(ptr, (uint32_t)mbin_power_64(3, log3_max), nthreads, MBIN_XFORM3_FWD_ADD);
+}
+
+/*
+ * Inverse exclusive or transform (r3).
+ */
+void
+mbin_inverse_r3_xor2_xform_32(uint32_t *ptr, uint8_t log3_max)
+{
+	mbin_xform3_engine_32(ptr, (uint32_t)mbin_power_64(3, log3_max), 1, MBIN_XFORM3_INV_XOR2);
+}
+
+void
+mbin_inverse_r3_xor2_xform_mt_32(uint32_t *ptr, uint8_t log3_max, uint32_t nthreads)
+{
+	mbin_xform3_engine_32(ptr, (uint32_t)mbin_power_64(3, log3_max), nthreads, MBIN_XFORM3_INV_XOR2);
+}
+
 /*
  * Forward exclusive or transform (r3).
  */
 void
 mbin_forward_r3_xor2_xform_32(uint32_t *ptr, uint8_t log3_max)
 {
-	const uint32_t max = mbin_power_64(3, log3_max);
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	int32_t a;
-	int32_t b;
-	int32_t c;
-
-	for (x = 3; x <= max; x *= 3) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 3); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 3)];
-				c = ptr[y + z + 2 * (x / 3)];
+	mbin_xform3_engine_32(ptr, (uint32_t)mbin_power_64(3, log3_max), 1, MBIN_XFORM3_FWD_XOR2);
+}
 
-				ptr[y + z + (x / 3)] = a ^ b ^ c;
-				ptr[y + z + 2 * (x / 3)] = a ^ c;
-			}
-		}
-	}
+void
+mbin_forward_r3_xor2_xform_mt_32(uint32_t *ptr, uint8_t log3_max, uint32_t nthreads)
+{
+	mbin_xform3_engine_32(ptr, (uint32_t)mbin_power_64(3, log3_max), nthreads, MBIN_XFORM3_FWD_XOR2);
 }
 
 /*
@@ -960,87 +1629,25 @@ mbin_forward_xor_add_xform_32(uint32_t *ptr, uint8_t log2_max, uint8_t lmax)
 void
 mbin_inverse_add_xform_double(double *ptr, uint8_t log2_max)
 {
-	const uint32_t max = 1U << log2_max;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	double a;
-	double b;
-
-	for (x = 2; x <= max; x *= 2) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 2); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 2)];
-				ptr[y + z + (x / 2)] = b - a;
-			}
-		}
-	}
+	mbin_xform2_engine_double(ptr, 1UL << log2_max, 1, MBIN_XFORM2_INV_ADD);
 }
 
 void
 mbin_forward_add_xform_double(double *ptr, uint8_t log2_max)
 {
-	const uint32_t max = 1U << log2_max;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	double a;
-	double b;
-
-	for (x = 2; x <= max; x *= 2) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 2); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 2)];
-				ptr[y + z + (x / 2)] = a + b;
-			}
-		}
-	}
-}
+	mbin_xform2_engine_double(ptr, 1UL << log2_max, 1, MBIN_XFORM2_FWD_ADD);
+}
 
 void
 mbin_inverse_add_xform_complex_double(struct mbin_complex_double *ptr, uint8_t log2_max)
 {
-	const uint32_t max = 1U << log2_max;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	struct mbin_complex_double a;
-	struct mbin_complex_double b;
-
-	for (x = 2; x <= max; x *= 2) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 2); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 2)];
-				ptr[y + z + (x / 2)].x = b.x - a.x;
-				ptr[y + z + (x / 2)].y = b.y - a.y;
-			}
-		}
-	}
+	mbin_xform2_engine_double((double *)ptr, 2UL << log2_max, 2, MBIN_XFORM2_INV_ADD);
 }
 
 void
 mbin_forward_add_xform_complex_double(struct mbin_complex_double *ptr, uint8_t log2_max)
 {
-	const uint32_t max = 1U << log2_max;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	struct mbin_complex_double a;
-	struct mbin_complex_double b;
-
-	for (x = 2; x <= max; x *= 2) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 2); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 2)];
-				ptr[y + z + (x / 2)].x = a.x + b.x;
-				ptr[y + z + (x / 2)].y = a.y + b.y;
-			}
-		}
-	}
+	mbin_xform2_engine_double((double *)ptr, 2UL << log2_max, 2, MBIN_XFORM2_FWD_ADD);
 }
 
 /*
@@ -1051,22 +1658,7 @@ mbin_forward_add_xform_complex_double(struct mbin_complex_double *ptr, uint8_t l
 void
 mbin_inverse_rev_add_xform_32(uint32_t *ptr, uint8_t log2_max)
 {
-	const uint32_t max = 1U << log2_max;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	int32_t a;
-	int32_t b;
-
-	for (x = 2; x <= max; x *= 2) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 2); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 2)];
-				ptr[y + z] = a - b;
-			}
-		}
-	}
+	mbin_xform2_engine_32(ptr, 1UL << log2_max, 1, MBIN_XFORM2_INV_REV);
 }
 
 /*
@@ -1077,108 +1669,31 @@ mbin_inverse_rev_add_xform_32(uint32_t *ptr, uint8_t log2_max)
 void
 mbin_forward_rev_add_xform_32(uint32_t *ptr, uint8_t log2_max)
 {
-	const uint32_t max = 1U << log2_max;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	int32_t a;
-	int32_t b;
-
-	for (x = 2; x <= max; x *= 2) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 2); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 2)];
-				ptr[y + z] = a + b;
-			}
-		}
-	}
+	mbin_xform2_engine_32(ptr, 1UL << log2_max, 1, MBIN_XFORM2_FWD_REV);
 }
 
 void
 mbin_inverse_rev_add_xform_double(double *ptr, uint8_t log2_max)
 {
-	const uint32_t max = 1U << log2_max;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	double a;
-	double b;
-
-	for (x = 2; x <= max; x *= 2) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 2); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 2)];
-				ptr[y + z] = a - b;
-			}
-		}
-	}
+	mbin_xform2_engine_double(ptr, 1UL << log2_max, 1, MBIN_XFORM2_INV_REV);
 }
 
 void
 mbin_forward_rev_add_xform_double(double *ptr, uint8_t log2_max)
 {
-	const uint32_t max = 1U << log2_max;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	double a;
-	double b;
-
-	for (x = 2; x <= max; x *= 2) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 2); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 2)];
-				ptr[y + z] = a + b;
-			}
-		}
-	}
+	mbin_xform2_engine_double(ptr, 1UL << log2_max, 1, MBIN_XFORM2_FWD_REV);
 }
 
 void
 mbin_inverse_rev_add_xform_complex_double(struct mbin_complex_double *ptr, uint8_t log2_max)
 {
-	const uint32_t max = 1U << log2_max;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	struct mbin_complex_double a;
-	struct mbin_complex_double b;
-
-	for (x = 2; x <= max; x *= 2) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 2); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 2)];
-				ptr[y + z].x = a.x - b.x;
-				ptr[y + z].y = a.y - b.y;
-			}
-		}
-	}
+	mbin_xform2_engine_double((double *)ptr, 2UL << log2_max, 2, MBIN_XFORM2_INV_REV);
 }
 
 void
 mbin_forward_rev_add_xform_complex_double(struct mbin_complex_double *ptr, uint8_t log2_max)
 {
-	const uint32_t max = 1U << log2_max;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	struct mbin_complex_double a;
-	struct mbin_complex_double b;
-
-	for (x = 2; x <= max; x *= 2) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 2); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 2)];
-				ptr[y + z].x = a.x + b.x;
-				ptr[y + z].y = a.y + b.y;
-			}
-		}
-	}
+	mbin_xform2_engine_double((double *)ptr, 2UL << log2_max, 2, MBIN_XFORM2_FWD_REV);
 }
 
 /*
@@ -1189,45 +1704,143 @@ mbin_forward_rev_add_xform_complex_double(struct mbin_complex_double *ptr, uint8
 void
 mbin_xor_xform_32(uint32_t *ptr, uint8_t log2_max)
 {
-	const uint32_t max = 1U << log2_max;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	uint32_t a;
-	uint32_t b;
+	mbin_xform2_engine_32(ptr, 1UL << log2_max, 1, MBIN_XFORM2_XOR);
+}
 
-	for (x = 2; x <= max; x *= 2) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 2); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 2)];
-				ptr[y + z + (x / 2)] = a ^ b;
+void
+mbin_xor_xform_64(uint64_t *ptr, uint8_t log2_max)
+{
+	mbin_xform2_engine_64(ptr, 1UL << log2_max, 1, MBIN_XFORM2_XOR);
+}
+
+#define	MBIN_XFORM_OP_XOR 0
+#define	MBIN_XFORM_OP_SUB 1
+#define	MBIN_XFORM_OP_ADD 2
+
+struct mbin_xform_mt_32 {
+	uint32_t *ptr;
+	uint8_t	log2_max;
+	uint8_t	log2_low;
+	uint8_t	phase;
+	uint8_t	op;
+};
+
+/*
+ * Transform along the rows of a table, where every row is "width"
+ * elements wide and rows are "stride" elements apart.
+ */
+static void
+mbin_xform_rows_32(uint32_t *ptr, size_t stride, size_t rows,
+    size_t width, uint8_t op)
+{
+	uint32_t *pa;
+	uint32_t *pb;
+	size_t x;
+	size_t y;
+	size_t z;
+	size_t w;
+
+	for (x = 1; x < rows; x *= 2) {
+		for (y = 0; y != rows; y += 2 * x) {
+			for (z = y; z != y + x; z++) {
+				pa = ptr + (z * stride);
+				pb = pa + (x * stride);
+
+				switch (op) {
+				case MBIN_XFORM_OP_XOR:
+					for (w = 0; w != width; w++)
+						pb[w] ^= pa[w];
+					break;
+				case MBIN_XFORM_OP_SUB:
+					for (w = 0; w != width; w++)
+						pb[w] -= pa[w];
+					break;
+				default:
+					for (w = 0; w != width; w++)
+						pb[w] += pa[w];
+					break;
+				}
 			}
 		}
 	}
 }
 
-void
-mbin_xor_xform_64(uint64_t *ptr, uint8_t log2_max)
+static void
+mbin_xform_mt_worker_32(void *arg, uint32_t index, uint32_t num)
 {
-	const uint32_t max = 1U << log2_max;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	uint64_t a;
-	uint64_t b;
+	struct mbin_xform_mt_32 *pxf = arg;
+	const size_t low = 1UL << pxf->log2_low;
+	const size_t width = low / num;
 
-	for (x = 2; x <= max; x *= 2) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 2); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 2)];
-				ptr[y + z + (x / 2)] = a ^ b;
-			}
+	if (pxf->phase == 0) {
+		/* transform the low bits, one block per thread */
+		uint32_t *ptr = pxf->ptr + (index * low);
+
+		switch (pxf->op) {
+		case MBIN_XFORM_OP_XOR:
+			mbin_xor_xform_32(ptr, pxf->log2_low);
+			break;
+		case MBIN_XFORM_OP_SUB:
+			mbin_inverse_add_xform_32(ptr, pxf->log2_low);
+			break;
+		default:
+			mbin_forward_add_xform_32(ptr, pxf->log2_low);
+			break;
 		}
+	} else {
+		/* transform the high bits, one column range per thread */
+		mbin_xform_rows_32(pxf->ptr + (index * width), low,
+		    num, width, pxf->op);
 	}
 }
 
+/*
+ * Multi-threaded version of the subset transforms. The table is
+ * split into one block per thread for the low bits, and into one
+ * column range per thread for the high bits, so that all threads
+ * work on separate memory in both passes.
+ */
+static void
+mbin_xform_mt_32(uint32_t *ptr, uint8_t log2_max, uint32_t nthreads, uint8_t op)
+{
+	struct mbin_xform_mt_32 xf;
+	uint8_t log2_thr;
+
+	for (log2_thr = 0; (2U << log2_thr) <= nthreads &&
+	    (2 * (log2_thr + 1)) <= log2_max; log2_thr++)
+		;
+
+	xf.ptr = ptr;
+	xf.log2_max = log2_max;
+	xf.log2_low = log2_max - log2_thr;
+	xf.op = op;
+
+	xf.phase = 0;
+	mbin_thread_run(&mbin_xform_mt_worker_32, &xf, 1U << log2_thr);
+	if (log2_thr == 0)
+		return;
+	xf.phase = 1;
+	mbin_thread_run(&mbin_xform_mt_worker_32, &xf, 1U << log2_thr);
+}
+
+void
+mbin_xor_xform_mt_32(uint32_t *ptr, uint8_t log2_max, uint32_t nthreads)
+{
+	mbin_xform_mt_32(ptr, log2_max, nthreads, MBIN_XFORM_OP_XOR);
+}
+
+void
+mbin_inverse_add_xform_mt_32(uint32_t *ptr, uint8_t log2_max, uint32_t nthreads)
+{
+	mbin_xform_mt_32(ptr, log2_max, nthreads, MBIN_XFORM_OP_SUB);
+}
+
+void
+mbin_forward_add_xform_mt_32(uint32_t *ptr, uint8_t log2_max, uint32_t nthreads)
+{
+	mbin_xform_mt_32(ptr, log2_max, nthreads, MBIN_XFORM_OP_ADD);
+}
+
 void
 mbin_xor_xform_print_32(const uint32_t *a, uint8_t log2_max)
 {
@@ -1319,23 +1932,7 @@ mbin_polar_and_add_xform_double(double *ptr, uint8_t log2_max)
 void
 mbin_sumdigits_r2_xform_32(uint32_t *ptr, uint8_t log2_max)
 {
-	const uint32_t max = 1U << log2_max;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	int32_t a;
-	int32_t b;
-
-	for (x = 2; x <= max; x *= 2) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 2); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 2)];
-				ptr[y + z] = a + b;
-				ptr[y + z + (x / 2)] = a - b;
-			}
-		}
-	}
+	mbin_xform2_engine_32(ptr, 1UL << log2_max, 1, MBIN_XFORM2_WHT);
 }
 
 /*
@@ -1346,23 +1943,7 @@ mbin_sumdigits_r2_xform_32(uint32_t *ptr, uint8_t log2_max)
 void
 mbin_sumdigits_r2_xform_64(uint64_t *ptr, uint8_t log2_max)
 {
-	const uint32_t max = 1U << log2_max;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	int64_t a;
-	int64_t b;
-
-	for (x = 2; x <= max; x *= 2) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 2); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 2)];
-				ptr[y + z] = a + b;
-				ptr[y + z + (x / 2)] = a - b;
-			}
-		}
-	}
+	mbin_xform2_engine_64(ptr, 1UL << log2_max, 1, MBIN_XFORM2_WHT);
 }
 
 /*
@@ -1373,23 +1954,7 @@ mbin_sumdigits_r2_xform_64(uint64_t *ptr, uint8_t log2_max)
 void
 mbin_sumdigits_r2_xform_double(double *ptr, uint8_t log2_max)
 {
-	const uint32_t max = 1U << log2_max;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	double a;
-	double b;
-
-	for (x = 2; x <= max; x *= 2) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 2); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 2)];
-				ptr[y + z] = a + b;
-				ptr[y + z + (x / 2)] = a - b;
-			}
-		}
-	}
+	mbin_xform2_engine_double(ptr, 1UL << log2_max, 1, MBIN_XFORM2_WHT);
 }
 
 /* Sumbits-and transform (radix-2) */
@@ -1397,25 +1962,7 @@ mbin_sumdigits_r2_xform_double(double *ptr, uint8_t log2_max)
 void
 mbin_sumdigits_r2_xform_complex_double(struct mbin_complex_double *ptr, uint8_t log2_max)
 {
-	const uint32_t max = 1U << log2_max;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-	struct mbin_complex_double a;
-	struct mbin_complex_double b;
-
-	for (x = 2; x <= max; x *= 2) {
-		for (y = 0; y != max; y += x) {
-			for (z = 0; z != (x / 2); z++) {
-				a = ptr[y + z];
-				b = ptr[y + z + (x / 2)];
-				ptr[y + z].x = a.x + b.x;
-				ptr[y + z].y = a.y + b.y;
-				ptr[y + z + (x / 2)].x = a.x - b.x;
-				ptr[y + z + (x / 2)].y = a.y - b.y;
-			}
-		}
-	}
+	mbin_xform2_engine_double((double *)ptr, 2UL << log2_max, 2, MBIN_XFORM2_WHT);
 }
 
 /*
@@ -1892,95 +2439,201 @@ mbin_xor2_power_mod_xform_64(uint64_t *ptr, uint32_t size,
 	}
 }
 
-void
-mbin_xor2_multi_xform_32(uint32_t *ptr, const uint32_t *fact)
+#define	MBIN_MULTI_OP_XOR2 0
+#define	MBIN_MULTI_OP_XOR3 1
+#define	MBIN_MULTI_OP_SUB 2
+
+#define	MBIN_MULTI_MT_MIN (1UL << 14)	/* columns per thread */
+
+struct mbin_multi_mt_32 {
+	uint32_t *ptr;
+	size_t	step;
+	size_t	cols;
+	uint32_t radix;
+	uint8_t	op;
+};
+
+static __always_inline uint32_t
+mbin_multi_diff_32(uint32_t a, uint32_t b, const uint8_t op)
 {
-	const uint32_t *curr;
-	uint32_t size = 1;
-	uint32_t step = 1;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
+	switch (op) {
+	case MBIN_MULTI_OP_XOR2:
+		return (a ^ b);
+	case MBIN_MULTI_OP_XOR3:
+		return (mbin_xor3_32(a, mbin_xor3_32(b, b)));
+	default:
+		return (a - b);
+	}
+}
 
-	for (curr = fact; curr[0] != 1; curr++)
-		size *= curr[0];
+/*
+ * Replace every element by the difference to the previous element
+ * along an axis of length "radix" and stride "step". Only the
+ * columns from "start" to "stop" are processed, where column "c"
+ * starts at element ((c / step) * radix * step) + (c % step). Going
+ * backwards along the axis means no carry is needed, and the inner
+ * loop runs over consecutive elements.
+ */
+static __always_inline void
+mbin_multi_stage_32(uint32_t *ptr, const size_t step, size_t start,
+    const size_t stop, const uint32_t radix, const uint8_t op)
+{
+	uint32_t *pa;
+	uint32_t *pb;
+	size_t n;
+	size_t w;
+	size_t y;
+	uint32_t z;
 
-	for (curr = fact; curr[0] != 1; curr++) {
-		for (x = 0; x != size; x += curr[0] * step) {
-			for (y = 0; y != step; y++) {
-				uint32_t last = 0;
+	if (step == 1) {
+		for (; start != stop; start++) {
+			pa = ptr + (start * radix);
+			for (z = radix - 1; z != 0; z--)
+				pa[z] = mbin_multi_diff_32(pa[z], pa[z - 1], op);
+		}
+		return;
+	}
 
-				for (z = 0; z != curr[0]; z++) {
-					uint32_t t = (z * step) + x + y;
+	while (start != stop) {
+		y = start % step;
+		n = step - y;
+		if (n > stop - start)
+			n = stop - start;
+		pa = ptr + ((start - y) * radix) + y;
 
-					ptr[t] ^= last;
-					last ^= ptr[t];
-				}
-			}
+		for (z = radix - 1; z != 0; z--) {
+			pb = pa + (z * step);
+			for (w = 0; w != n; w++)
+				pb[w] = mbin_multi_diff_32(pb[w], pa[((z - 1) * step) + w], op);
 		}
-		step *= curr[0];
+		start += n;
 	}
 }
 
-void
-mbin_xor3_multi_xform_32(uint32_t *ptr, const uint32_t *fact)
+/*
+ * Select a kernel with a fixed radix for the common factors, so
+ * that the compiler can unroll the axis loop.
+ */
+static __always_inline void
+mbin_multi_radix_32(uint32_t *ptr, size_t step, size_t start,
+    size_t stop, uint32_t radix, const uint8_t op)
+{
+	switch (radix) {
+	case 2:
+		mbin_multi_stage_32(ptr, step, start, stop, 2, op);
+		break;
+	case 3:
+		mbin_multi_stage_32(ptr, step, start, stop, 3, op);
+		break;
+	case 4:
+		mbin_multi_stage_32(ptr, step, start, stop, 4, op);
+		break;
+	case 5:
+		mbin_multi_stage_32(ptr, step, start, stop, 5, op);
+		break;
+	case 7:
+		mbin_multi_stage_32(ptr, step, start, stop, 7, op);
+		break;
+	default:
+		mbin_multi_stage_32(ptr, step, start, stop, radix, op);
+		break;
+	}
+}
+
+static void
+mbin_multi_mt_worker_32(void *arg, uint32_t index, uint32_t num)
+{
+	struct mbin_multi_mt_32 *pmx = arg;
+	const size_t start = (pmx->cols * index) / num;
+	const size_t stop = (pmx->cols * (index + 1)) / num;
+
+	switch (pmx->op) {
+	case MBIN_MULTI_OP_XOR2:
+		mbin_multi_radix_32(pmx->ptr, pmx->step, start, stop,
+		    pmx->radix, MBIN_MULTI_OP_XOR2);
+		break;
+	case MBIN_MULTI_OP_XOR3:
+		mbin_multi_radix_32(pmx->ptr, pmx->step, start, stop,
+		    pmx->radix, MBIN_MULTI_OP_XOR3);
+		break;
+	default:
+		mbin_multi_radix_32(pmx->ptr, pmx->step, start, stop,
+		    pmx->radix, MBIN_MULTI_OP_SUB);
+		break;
+	}
+}
+
+/*
+ * Mixed radix transform, where "fact" is a list of factors
+ * terminated by a factor of one. Every stage is split into column
+ * ranges, which are processed by up to "nthreads" threads.
+ */
+static void
+mbin_multi_xform_32(uint32_t *ptr, const uint32_t *fact,
+    uint32_t nthreads, uint8_t op)
 {
+	struct mbin_multi_mt_32 mx;
 	const uint32_t *curr;
-	uint32_t size = 1;
-	uint32_t step = 1;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
+	size_t size = 1;
+	uint32_t num;
 
 	for (curr = fact; curr[0] != 1; curr++)
 		size *= curr[0];
 
+	mx.ptr = ptr;
+	mx.step = 1;
+	mx.op = op;
+
 	for (curr = fact; curr[0] != 1; curr++) {
-		for (x = 0; x != size; x += curr[0] * step) {
-			for (y = 0; y != step; y++) {
-				uint32_t last = 0;
+		mx.radix = curr[0];
+		mx.cols = size / curr[0];
 
-				for (z = 0; z != curr[0]; z++) {
-					uint32_t t = (z * step) + x + y;
+		num = nthreads;
+		if (num > mx.cols / MBIN_MULTI_MT_MIN)
+			num = mx.cols / MBIN_MULTI_MT_MIN;
+		if (num < 2)
+			mbin_multi_mt_worker_32(&mx, 0, 1);
+		else
+			mbin_thread_run(&mbin_multi_mt_worker_32, &mx, num);
 
-					ptr[t] = mbin_xor3_32(ptr[t],
-					    mbin_xor3_32(last, last));
-					last = mbin_xor3_32(last, ptr[t]);
-				}
-			}
-		}
-		step *= curr[0];
+		mx.step *= curr[0];
 	}
 }
 
 void
-mbin_add_inv_multi_xform_32(uint32_t *ptr, const uint32_t *fact)
+mbin_xor2_multi_xform_32(uint32_t *ptr, const uint32_t *fact)
 {
-	const uint32_t *curr;
-	uint32_t size = 1;
-	uint32_t step = 1;
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
+	mbin_multi_xform_32(ptr, fact, 1, MBIN_MULTI_OP_XOR2);
+}
 
-	for (curr = fact; curr[0] != 1; curr++)
-		size *= curr[0];
+void
+mbin_xor2_multi_xform_mt_32(uint32_t *ptr, const uint32_t *fact, uint32_t nthreads)
+{
+	mbin_multi_xform_32(ptr, fact, nthreads, MBIN_MULTI_OP_XOR2);
+}
 
-	for (curr = fact; curr[0] != 1; curr++) {
-		for (x = 0; x != size; x += curr[0] * step) {
-			for (y = 0; y != step; y++) {
-				uint32_t last = 0;
+void
+mbin_xor3_multi_xform_32(uint32_t *ptr, const uint32_t *fact)
+{
+	mbin_multi_xform_32(ptr, fact, 1, MBIN_MULTI_OP_XOR3);
+}
 
-				for (z = 0; z != curr[0]; z++) {
-					uint32_t t = (z * step) + x + y;
+void
+mbin_xor3_multi_xform_mt_32(uint32_t *ptr, const uint32_t *fact, uint32_t nthreads)
+{
+	mbin_multi_xform_32(ptr, fact, nthreads, MBIN_MULTI_OP_XOR3);
+}
 
-					ptr[t] -= last;
-					last += ptr[t];
-				}
-			}
-		}
-		step *= curr[0];
-	}
+void
+mbin_add_inv_multi_xform_32(uint32_t *ptr, const uint32_t *fact)
+{
+	mbin_multi_xform_32(ptr, fact, 1, MBIN_MULTI_OP_SUB);
+}
+
+void
+mbin_add_inv_multi_xform_mt_32(uint32_t *ptr, const uint32_t *fact, uint32_t nthreads)
+{
+	mbin_multi_xform_32(ptr, fact, nthreads, MBIN_MULTI_OP_SUB);
 }
 
 void
@@ -2060,92 +2713,47 @@ mbin_xor_mod_inv_multi_xform_32(uint32_t *ptr, const uint32_t *fact)
 void
 mbin_xform3_fwd_double(double *ptr, const uint32_t max)
 {
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
-
-	for (x = 1; x != max; x *= 3) {
-		for (y = 0; y != max; y += (3 * x)) {
-			for (z = y; z != (y + x); z++) {
-				double a;
-				double b;
-				double c;
-
-				a = ptr[z];
-				b = ptr[z + x];
-				c = ptr[z + 2 * x] + a;
+	mbin_xform3_engine_double(ptr, max, 1, MBIN_XFORM3_FWD);
+}
 
-				ptr[z + x] = (c + b);
-				ptr[z + 2 * x] = (c - b);
-			}
-		}
-	}
+void
+mbin_xform3_fwd_mt_double(double *ptr, const uint32_t max, uint32_t nthreads)
+{
+	mbin_xform3_engine_double(ptr, max, nthreads, MBIN_XFORM3_FWD);
 }
 
 void
 mbin_xform3_inv_double(double *ptr, const uint32_t max)
 {
-	uint32_t x;
-	uint32_t y;
-	uint32_t z;
+	mbin_xform3_engine_double(ptr, max, 1, MBIN_XFORM3_INV);
+}
 
-	for (x = 1; x != max; x *= 3) {
-		for (y = 0; y != max; y += (3 * x)) {
-			for (z = y; z != (x + y); z++) {
-				double a;
-				double b;
-				double c;
-
-				a = ptr[z];
-				b = ptr[z + x] - a;
-				c = ptr[z + 2 * x] - a;
-				ptr[z + x] = (b - c) / 2;
-				ptr[z + 2 * x] = (b + c) / 2;
-			}
-		}
-	}
+void
+mbin_xform3_inv_mt_double(double *ptr, const uint32_t max, uint32_t nthreads)
+{
+	mbin_xform3_engine_double(ptr, max, nthreads, MBIN_XFORM3_INV);
 }
 
 void
 mbin_xform3_alt_fwd_double(double *ptr, const size_t wmax)
 {
-	size_t f, g, h;
-
-	for (f = 1; f != wmax; f *= 3) {
-		for (g = 0; g != wmax; g += 3 * f) {
-			for (h = 0; h != f; h++) {
-				double aa, bb, cc;
-
-				aa = ptr[g + f * 0 + h];
-				bb = ptr[g + f * 1 + h];
-				cc = ptr[g + f * 2 + h];
+	mbin_xform3_engine_double(ptr, wmax, 1, MBIN_XFORM3_ALT_FWD);
+}
 
-				ptr[g + f * 0 + h] = (aa + bb);
-				ptr[g + f * 1 + h] = (aa + cc);
-				ptr[g + f * 2 + h] = (bb + cc);
-			}
-		}
-	}
+void
+mbin_xform3_alt_fwd_mt_double(double *ptr, const size_t wmax, uint32_t nthreads)
+{
+	mbin_xform3_engine_double(ptr, wmax, nthreads, MBIN_XFORM3_ALT_FWD);
 }
 
 void
 mbin_xform3_alt_inv_double(double *ptr, const size_t wmax)
 {
-	size_t f, g, h;
-
-	for (f = 1; f != wmax; f *= 3) {
-		for (g = 0; g != wmax; g += 3 * f) {
-			for (h = 0; h != f; h++) {
-				double aa, bb, cc;
-
-				aa = ptr[g + f * 0 + h];
-				bb = ptr[g + f * 1 + h];
-				cc = ptr[g + f * 2 + h];
+	mbin_xform3_engine_double(ptr, wmax, 1, MBIN_XFORM3_ALT_INV);
+}
 
-				ptr[g + f * 0 + h] = (aa + bb - cc) / 2.0;
-				ptr[g + f * 1 + h] = (aa + cc - bb) / 2.0;
-				ptr[g + f * 2 + h] = (bb + cc - aa) / 2.0;
-			}
-		}
-	}
+void
+mbin_xform3_alt_inv_mt_double(double *ptr, const size_t wmax, uint32_t nthreads)
+{
+	mbin_xform3_engine_double(ptr, wmax, nthreads, MBIN_XFORM3_ALT_INV);
 }
@@ -24,132 +24,425 @@
  */
 
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sysexits.h>
+#include <err.h>
 
 #include "math_bin.h"
 
-void
-mbin_vector_or_double(double *a, double *b, double *c, uint8_t bits)
-{
-	uint32_t max = 1U << bits;
-	uint32_t x;
+#define	MBIN_VECTOR_OR 0
+#define	MBIN_VECTOR_AND 1
+#define	MBIN_VECTOR_XOR 2
 
-	double at[max];
-	double bt[max];
+static void
+mbin_vector_apply_double(const double *a, const double *bt, double *c, uint8_t bits, const int op)
+{
+	const size_t max = 1UL << bits;
+	const size_t half = max / 2;
+	size_t x;
+	double lo;
+	double hi;
+
+	if (c != a)
+		memcpy(c, a, sizeof(c[0]) * max);
+
+	if (bits == 0) {
+		c[0] *= bt[0];
+		return;
+	}
+
+	/* forward transform of all but the highest bit */
+	switch (op) {
+	case MBIN_VECTOR_OR:
+		mbin_forward_add_xform_double(c, bits - 1);
+		mbin_forward_add_xform_double(c + half, bits - 1);
+		break;
+	case MBIN_VECTOR_AND:
+		mbin_forward_rev_add_xform_double(c, bits - 1);
+		mbin_forward_rev_add_xform_double(c + half, bits - 1);
+		break;
+	default:
+		mbin_sumdigits_r2_xform_double(c, bits - 1);
+		mbin_sumdigits_r2_xform_double(c + half, bits - 1);
+		break;
+	}
+
+	/*
+	 * The transforms are separable, so the highest bit can be
+	 * transformed last going forward and first going back, fused
+	 * with the pointwise multiplication in a single pass.
+	 */
+	for (x = 0; x != half; x++) {
+		lo = c[x];
+		hi = c[x + half];
+
+		switch (op) {
+		case MBIN_VECTOR_OR:
+			hi += lo;
+			lo *= bt[x];
+			hi *= bt[x + half];
+			hi -= lo;
+			break;
+		case MBIN_VECTOR_AND:
+			lo += hi;
+			lo *= bt[x];
+			hi *= bt[x + half];
+			lo -= hi;
+			break;
+		default: {
+			double t = lo;
+
+			lo = (t + hi) * bt[x];
+			hi = (t - hi) * bt[x + half];
+			t = lo;
+			lo = t + hi;
+			hi = t - hi;
+			break;
+		}
+		}
+		c[x] = lo;
+		c[x + half] = hi;
+	}
+
+	/* inverse transform of all but the highest bit */
+	switch (op) {
+	case MBIN_VECTOR_OR:
+		mbin_inverse_add_xform_double(c, bits - 1);
+		mbin_inverse_add_xform_double(c + half, bits - 1);
+		break;
+	case MBIN_VECTOR_AND:
+		mbin_inverse_rev_add_xform_double(c, bits - 1);
+		mbin_inverse_rev_add_xform_double(c + half, bits - 1);
+		break;
+	default:
+		mbin_sumdigits_r2_xform_double(c, bits - 1);
+		mbin_sumdigits_r2_xform_double(c + half, bits - 1);
+		break;
+	}
+}
 
-	memcpy(at, a, sizeof(at));
-	memcpy(bt, b, sizeof(bt));
+static void
+mbin_vector_double(const double *a, const double *b, double *c, uint8_t bits, const int op)
+{
+	const size_t max = 1UL << bits;
+	double *bt;
+
+	bt = malloc(sizeof(bt[0]) * max);
+	if (bt == NULL)
+		errx(EX_SOFTWARE, "Out of memory");
+
+	memcpy(bt, b, sizeof(bt[0]) * max);
+
+	switch (op) {
+	case MBIN_VECTOR_OR:
+		mbin_forward_add_xform_double(bt, bits);
+		break;
+	case MBIN_VECTOR_AND:
+		mbin_forward_rev_add_xform_double(bt, bits);
+		break;
+	default:
+		mbin_sumdigits_r2_xform_double(bt, bits);
+		break;
+	}
+
+	mbin_vector_apply_double(a, bt, c, bits, op);
+
+	free(bt);
+}
 
-	mbin_forward_add_xform_double(at, bits);
-	mbin_forward_add_xform_double(bt, bits);
+static void
+mbin_vector_apply_32(const uint32_t *a, const uint32_t *bt, uint32_t *c, uint8_t bits, const int op)
+{
+	const size_t max = 1UL << bits;
+	const size_t half = max / 2;
+	size_t x;
+	uint32_t lo;
+	uint32_t hi;
+
+	if (c != a)
+		memcpy(c, a, sizeof(c[0]) * max);
+
+	if (bits == 0) {
+		c[0] *= bt[0];
+		return;
+	}
+
+	/* forward transform of all but the highest bit */
+	switch (op) {
+	case MBIN_VECTOR_OR:
+		mbin_forward_add_xform_32(c, bits - 1);
+		mbin_forward_add_xform_32(c + half, bits - 1);
+		break;
+	case MBIN_VECTOR_AND:
+		mbin_forward_rev_add_xform_32(c, bits - 1);
+		mbin_forward_rev_add_xform_32(c + half, bits - 1);
+		break;
+	default:
+		mbin_sumdigits_r2_xform_32(c, bits - 1);
+		mbin_sumdigits_r2_xform_32(c + half, bits - 1);
+		break;
+	}
+
+	/*
+	 * The transforms are separable, so the highest bit can be
+	 * transformed last going forward and first going back, fused
+	 * with the pointwise multiplication in a single pass.
+	 */
+	for (x = 0; x != half; x++) {
+		lo = c[x];
+		hi = c[x + half];
+
+		switch (op) {
+		case MBIN_VECTOR_OR:
+			hi += lo;
+			lo *= bt[x];
+			hi *= bt[x + half];
+			hi -= lo;
+			break;
+		case MBIN_VECTOR_AND:
+			lo += hi;
+			lo *= bt[x];
+			hi *= bt[x + half];
+			lo -= hi;
+			break;
+		default: {
+			uint32_t t = lo;
+
+			lo = (t + hi) * bt[x];
+			hi = (t - hi) * bt[x + half];
+			t = lo;
+			lo = t + hi;
+			hi = t - hi;
+			break;
+		}
+		}
+		c[x] = lo;
+		c[x + half] = hi;
+	}
+
+	/* inverse transform of all but the highest bit */
+	switch (op) {
+	case MBIN_VECTOR_OR:
+		mbin_inverse_add_xform_32(c, bits - 1);
+		mbin_inverse_add_xform_32(c + half, bits - 1);
+		break;
+	case MBIN_VECTOR_AND:
+		mbin_inverse_rev_add_xform_32(c, bits - 1);
+		mbin_inverse_rev_add_xform_32(c + half, bits - 1);
+		break;
+	default:
+		mbin_sumdigits_r2_xform_32(c, bits - 1);
+		mbin_sumdigits_r2_xform_32(c + half, bits - 1);
+		break;
+	}
+}
 
-	for (x = 0; x != max; x++)
-		c[x] = at[x] * bt[x];
+static void
+mbin_vector_32(const uint32_t *a, const uint32_t *b, uint32_t *c, uint8_t bits, const int op)
+{
+	const size_t max = 1UL << bits;
+	uint32_t *bt;
+
+	bt = malloc(sizeof(bt[0]) * max);
+	if (bt == NULL)
+		errx(EX_SOFTWARE, "Out of memory");
+
+	memcpy(bt, b, sizeof(bt[0]) * max);
+
+	switch (op) {
+	case MBIN_VECTOR_OR:
+		mbin_forward_add_xform_32(bt, bits);
+		break;
+	case MBIN_VECTOR_AND:
+		mbin_forward_rev_add_xform_32(bt, bits);
+		break;
+	default:
+		mbin_sumdigits_r2_xform_32(bt, bits);
+		break;
+	}
+
+	mbin_vector_apply_32(a, bt, c, bits, op);
+
+	free(bt);
+}
 
-	mbin_inverse_add_xform_double(c, bits);
+void
+mbin_vector_or_double(double *a, double *b, double *c, uint8_t bits)
+{
+	mbin_vector_double(a, b, c, bits, MBIN_VECTOR_OR);
 }
 
 void
 mbin_vector_or_32(uint32_t *a, uint32_t *b, uint32_t *c, uint8_t bits)
 {
-	uint32_t max = 1U << bits;
-	uint32_t x;
-
-	uint32_t at[max];
-	uint32_t bt[max];
-
-	memcpy(at, a, sizeof(at));
-	memcpy(bt, b, sizeof(bt));
-
-	mbin_forward_add_xform_32(at, bits);
-	mbin_forward_add_xform_32(bt, bits);
-
-	for (x = 0; x != max; x++)
-		c[x] = at[x] * bt[x];
-
-	mbin_inverse_add_xform_32(c, bits);
+	mbin_vector_32(a, b, c, bits, MBIN_VECTOR_OR);
 }
 
 void
 mbin_vector_and_double(double *a, double *b, double *c, uint8_t bits)
 {
-	uint32_t max = 1U << bits;
-	uint32_t x;
-
-	double at[max];
-	double bt[max];
-
-	memcpy(at, a, sizeof(at));
-	memcpy(bt, b, sizeof(bt));
-
-	mbin_forward_rev_add_xform_double(at, bits);
-	mbin_forward_rev_add_xform_double(bt, bits);
-
-	for (x = 0; x != max; x++)
-		c[x] = at[x] * bt[x];
-
-	mbin_inverse_rev_add_xform_double(c, bits);
+	mbin_vector_double(a, b, c, bits, MBIN_VECTOR_AND);
 }
 
 void
 mbin_vector_and_32(uint32_t *a, uint32_t *b, uint32_t *c, uint8_t bits)
 {
-	uint32_t max = 1U << bits;
-	uint32_t x;
+	mbin_vector_32(a, b, c, bits, MBIN_VECTOR_AND);
+}
 
-	uint32_t at[max];
-	uint32_t bt[max];
+void
+mbin_vector_xor_double(double *a, double *b, double *c, uint8_t bits)
+{
+	mbin_vector_double(a, b, c, bits, MBIN_VECTOR_XOR);
+}
 
-	memcpy(at, a, sizeof(at));
-	memcpy(bt, b, sizeof(bt));
+void
+mbin_vector_xor_32(uint32_t *a, uint32_t *b, uint32_t *c, uint8_t bits)
+{
+	mbin_vector_32(a, b, c, bits, MBIN_VECTOR_XOR);
+}
 
-	mbin_forward_rev_add_xform_32(at, bits);
-	mbin_forward_rev_add_xform_32(bt, bits);
+void
+mbin_vector_or_apply_double(const double *a, const double *bt, double *c, uint8_t bits)
+{
+	mbin_vector_apply_double(a, bt, c, bits, MBIN_VECTOR_OR);
+}
 
-	for (x = 0; x != max; x++)
-		c[x] = at[x] * bt[x];
+void
+mbin_vector_or_apply_32(const uint32_t *a, const uint32_t *bt, uint32_t *c, uint8_t bits)
+{
+	mbin_vector_apply_32(a, bt, c, bits, MBIN_VECTOR_OR);
+}
 
-	mbin_inverse_rev_add_xform_32(c, bits);
+void
+mbin_vector_and_apply_double(const double *a, const double *bt, double *c, uint8_t bits)
+{
+	mbin_vector_apply_double(a, bt, c, bits, MBIN_VECTOR_AND);
 }
 
 void
-mbin_vector_xor_double(double *a, double *b, double *c, uint8_t bits)
+mbin_vector_and_apply_32(const uint32_t *a, const uint32_t *bt, uint32_t *c, uint8_t bits)
 {
-	uint32_t max = 1U << bits;
-	uint32_t x;
+	mbin_vector_apply_32(a, bt, c, bits, MBIN_VECTOR_AND);
+}
 
-	double at[max];
-	double bt[max];
+void
+mbin_vector_xor_apply_double(const double *a, const double *bt, double *c, uint8_t bits)
+{
+	mbin_vector_apply_double(a, bt, c, bits, MBIN_VECTOR_XOR);
+}
 
-	memcpy(at, a, sizeof(at));
-	memcpy(bt, b, sizeof(bt));
+void
+mbin_vector_xor_apply_32(const uint32_t *a, const uint32_t *bt, uint32_t *c, uint8_t bits)
+{
+	mbin_vector_apply_32(a, bt, c, bits, MBIN_VECTOR_XOR);
+}
 
-	mbin_sumdigits_r2_xform_double(at, bits);
-	mbin_sumdigits_r2_xform_double(bt, bits);
+/*
+ * Ranked subset convolution, also known as the disjoint union
+ * product:
+ *
+ * c[x] = sum over all (y | z) == x and (y & z) == 0 of a[y] * b[z]
+ */
+void
+mbin_vector_subset_double(const double *a, const double *b, double *c, uint8_t bits)
+{
+	const size_t max = 1UL << bits;
+	double *fa;
+	double *fb;
+	double *fc;
+	size_t x;
+	uint8_t r;
+	uint8_t s;
+
+	fa = calloc(3 * (bits + 1) * max, sizeof(fa[0]));
+	if (fa == NULL)
+		errx(EX_SOFTWARE, "Out of memory");
+	fb = fa + (bits + 1) * max;
+	fc = fb + (bits + 1) * max;
+
+	/* split the inputs by rank and transform */
+	for (x = 0; x != max; x++) {
+		r = mbin_sumbits32(x);
+		fa[r * max + x] = a[x];
+		fb[r * max + x] = b[x];
+	}
+	for (r = 0; r <= bits; r++) {
+		mbin_forward_add_xform_double(fa + r * max, bits);
+		mbin_forward_add_xform_double(fb + r * max, bits);
+	}
+
+	/* multiply ranks which add up */
+	for (r = 0; r <= bits; r++) {
+		double *pc = fc + r * max;
+
+		for (s = 0; s <= r; s++) {
+			const double *pa = fa + s * max;
+			const double *pb = fb + (r - s) * max;
+
+			for (x = 0; x != max; x++)
+				pc[x] += pa[x] * pb[x];
+		}
+		mbin_inverse_add_xform_double(pc, bits);
+	}
 
 	for (x = 0; x != max; x++)
-		c[x] = at[x] * bt[x];
+		c[x] = fc[mbin_sumbits32(x) * max + x];
 
-	mbin_sumdigits_r2_xform_double(c, bits);
+	free(fa);
 }
 
+/*
+ * Ranked subset convolution, also known as the disjoint union
+ * product:
+ *
+ * c[x] = sum over all (y | z) == x and (y & z) == 0 of a[y] * b[z]
+ */
 void
-mbin_vector_xor_32(uint32_t *a, uint32_t *b, uint32_t *c, uint8_t bits)
+mbin_vector_subset_32(const uint32_t *a, const uint32_t *b, uint32_t *c, uint8_t bits)
 {
-	uint32_t max = 1U << bits;
-	uint32_t x;
-
-	uint32_t at[max];
-	uint32_t bt[max];
-
-	memcpy(at, a, sizeof(at));
-	memcpy(bt, b, sizeof(bt));
-
-	mbin_sumdigits_r2_xform_32(at, bits);
-	mbin_sumdigits_r2_xform_32(bt, bits);
+	const size_t max = 1UL << bits;
+	uint32_t *fa;
+	uint32_t *fb;
+	uint32_t *fc;
+	size_t x;
+	uint8_t r;
+	uint8_t s;
+
+	fa = calloc(3 * (bits + 1) * max, sizeof(fa[0]));
+	if (fa == NULL)
+		errx(EX_SOFTWARE, "Out of memory");
+	fb = fa + (bits + 1) * max;
+	fc = fb + (bits + 1) * max;
+
+	/* split the inputs by rank and transform */
+	for (x = 0; x != max; x++) {
+		r = mbin_sumbits32(x);
+		fa[r * max + x] = a[x];
+		fb[r * max + x] = b[x];
+	}
+	for (r = 0; r <= bits; r++) {
+		mbin_forward_add_xform_32(fa + r * max, bits);
+		mbin_forward_add_xform_32(fb + r * max, bits);
+	}
+
+	/* multiply ranks which add up */
+	for (r = 0; r <= bits; r++) {
+		uint32_t *pc = fc + r * max;
+
+		for (s = 0; s <= r; s++) {
+			const uint32_t *pa = fa + s * max;
+			const uint32_t *pb = fb + (r - s) * max;
+
+			for (x = 0; x != max; x++)
+				pc[x] += pa[x] * pb[x];
+		}
+		mbin_inverse_add_xform_32(pc, bits);
+	}
 
 	for (x = 0; x != max; x++)
-		c[x] = at[x] * bt[x];
+		c[x] = fc[mbin_sumbits32(x) * max + x];
 
-	mbin_sumdigits_r2_xform_32(c, bits);
+	free(fa);
 }
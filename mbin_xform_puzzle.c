@@ -23,9 +23,11 @@
  * SUCH DAMAGE.
  */
 
+#include <err.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sysexits.h>
 
 #include "math_bin.h"
 
@@ -200,19 +202,130 @@ mbin_xform_puzzle_sort(mbin_xform_puzzle_head_t *phead)
 	free(array);
 }
 
+/*
+ * Index of puzzle pieces keyed on their end offset, "start" + "size".
+ * Pieces sharing an end offset are chained in list order. All entries
+ * and buckets live in two arrays which are reused between rounds.
+ */
+struct mbin_xform_puzzle_ent {
+	struct mbin_xform_puzzle *ptr;
+	size_t	next;
+};
+
+struct mbin_xform_puzzle_bkt {
+	ssize_t	end;
+	size_t	head;
+	size_t	tail;
+};
+
+struct mbin_xform_puzzle_index {
+	struct mbin_xform_puzzle_ent *pent;
+	struct mbin_xform_puzzle_bkt *pbkt;
+	size_t	nent;
+	size_t	ment;
+	size_t	nbkt;
+	size_t	mask;
+};
+
+#define	MBIN_XFORM_PUZZLE_NONE ((size_t)-1)
+
+static size_t
+mbin_xform_puzzle_hash(ssize_t end, size_t mask)
+{
+	return (((uint64_t)end * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+static struct mbin_xform_puzzle_bkt *
+mbin_xform_puzzle_index_find(struct mbin_xform_puzzle_index *pidx, ssize_t end)
+{
+	size_t h;
+
+	for (h = mbin_xform_puzzle_hash(end, pidx->mask);
+	    pidx->pbkt[h].head != MBIN_XFORM_PUZZLE_NONE &&
+	    pidx->pbkt[h].end != end; h = (h + 1) & pidx->mask)
+		;
+	return (pidx->pbkt + h);
+}
+
+static void
+mbin_xform_puzzle_index_insert(struct mbin_xform_puzzle_index *pidx,
+    struct mbin_xform_puzzle *ptr)
+{
+	struct mbin_xform_puzzle_bkt *pb;
+	size_t x;
+
+	if (pidx->nent == pidx->ment) {
+		pidx->ment = pidx->ment ? 2 * pidx->ment : 64;
+		pidx->pent = realloc(pidx->pent, sizeof(pidx->pent[0]) * pidx->ment);
+		if (pidx->pent == NULL)
+			errx(EX_SOFTWARE, "Out of memory");
+	}
+
+	/* keep the load factor of the bucket array below one half */
+	if (2 * (pidx->nbkt + 1) > pidx->mask + 1) {
+		struct mbin_xform_puzzle_bkt *pold = pidx->pbkt;
+		size_t old = pold ? pidx->mask + 1 : 0;
+
+		pidx->mask = old ? (2 * old - 1) : 63;
+		pidx->pbkt = malloc(sizeof(pidx->pbkt[0]) * (pidx->mask + 1));
+		if (pidx->pbkt == NULL)
+			errx(EX_SOFTWARE, "Out of memory");
+		for (x = 0; x != pidx->mask + 1; x++)
+			pidx->pbkt[x].head = MBIN_XFORM_PUZZLE_NONE;
+		for (x = 0; x != old; x++) {
+			if (pold[x].head != MBIN_XFORM_PUZZLE_NONE)
+				*mbin_xform_puzzle_index_find(pidx, pold[x].end) = pold[x];
+		}
+		free(pold);
+	}
+
+	pidx->pent[pidx->nent].ptr = ptr;
+	pidx->pent[pidx->nent].next = MBIN_XFORM_PUZZLE_NONE;
+
+	pb = mbin_xform_puzzle_index_find(pidx, ptr->start + ptr->size);
+	if (pb->head == MBIN_XFORM_PUZZLE_NONE) {
+		pb->end = ptr->start + ptr->size;
+		pb->head = pidx->nent;
+		pidx->nbkt++;
+	} else {
+		pidx->pent[pb->tail].next = pidx->nent;
+	}
+	pb->tail = pidx->nent++;
+}
+
+static void
+mbin_xform_puzzle_index_reset(struct mbin_xform_puzzle_index *pidx)
+{
+	size_t x;
+
+	pidx->nent = 0;
+	pidx->nbkt = 0;
+	if (pidx->pbkt == NULL)
+		return;
+	for (x = 0; x != pidx->mask + 1; x++)
+		pidx->pbkt[x].head = MBIN_XFORM_PUZZLE_NONE;
+}
+
 int
 mbin_xform_puzzle_simplify(mbin_xform_puzzle_head_t *phead)
 {
+	struct mbin_xform_puzzle_index idx = {};
+	struct mbin_xform_puzzle_bkt *pb;
 	struct mbin_xform_puzzle *pother;
 	struct mbin_xform_puzzle *ptr;
 	int retval = 0;
 	int any;
 	size_t x;
 	size_t y;
+	size_t z;
 
 repeat:
 	mbin_xform_puzzle_sort(phead);
 
+	mbin_xform_puzzle_index_reset(&idx);
+	TAILQ_FOREACH(ptr, phead, entry)
+		mbin_xform_puzzle_index_insert(&idx, ptr);
+
 	any = 0;
 	TAILQ_FOREACH(ptr, phead, entry) {
 		size_t half = ptr->size / 2;
@@ -228,17 +341,23 @@ repeat:
 				pother->start = ptr->start;
 				pother->data[x] = ptr->data[x];
 
+				mbin_xform_puzzle_index_insert(&idx, pother);
+
 				ptr->data[x].var = ptr->data[x + half].var = 0;
 				ptr->data[x].val = ptr->data[x + half].val = 0;
 				any = 1;
 			}
 		}
 
+		/* only pieces with the same end offset can take variables */
+		pb = mbin_xform_puzzle_index_find(&idx, ptr->start + ptr->size);
+
 		for (x = 0; x != ptr->size; x++) {
 			if (ptr->data[x].val == 0.0)
 				continue;
 
-			TAILQ_FOREACH(pother, phead, entry) {
+			for (z = pb->head; z != MBIN_XFORM_PUZZLE_NONE; z = idx.pent[z].next) {
+				pother = idx.pent[z].ptr;
 				if (pother == ptr)
 					continue;
 
@@ -247,9 +366,8 @@ repeat:
 				if (y >= pother->size)
 					continue;
 
-				if ((ptr->start + ptr->size) == (pother->start + pother->size) &&
-				    (pother->data[y].val == 0.0 ||
-				    pother->data[y].var == ptr->data[x].var)) {
+				if (pother->data[y].val == 0.0 ||
+				    pother->data[y].var == ptr->data[x].var) {
 					pother->data[y].val += ptr->data[x].val;
 					pother->data[y].var = ptr->data[x].var;
 					ptr->data[x].val = 0;
@@ -288,6 +406,9 @@ retest:
 	if (any)
 		goto repeat;
 
+	free(idx.pent);
+	free(idx.pbkt);
+
 	return (retval);
 }
 
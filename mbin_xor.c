@@ -30,6 +30,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "math_bin.h"
@@ -1520,20 +1521,47 @@ mbin_xor2_coeff_64(int64_t n, int64_t x)
 	return (mbin_xor2_mul_64(mbin_xor2_div_odd_64(fa, fb), (shift >> 32)));
 }
 
-/* greatest common divisor for CRC's (modified Euclid equation) */
+/*
+ * Greatest common divisor for CRC's, using a binary algorithm. The
+ * polynomial "x" takes the role of two: common factors of "x" are
+ * shifted out, and adding two polynomials having a constant term
+ * gives one that is divisible by "x". Comparing the values is
+ * enough to order the polynomials by degree.
+ */
 uint64_t
 mbin_xor2_gcd_64(uint64_t a, uint64_t b)
 {
-	uint64_t an;
-	uint64_t bn;
+	uint64_t t;
+	int k;
 
-	while (b != 0) {
-		an = b;
-		bn = mbin_xor2_mod_64(a, b);
-		a = an;
-		b = bn;
-	}
-	return (a);
+	if (a == 0)
+		return (b);
+	if (b == 0)
+		return (a);
+
+	k = __builtin_ctzll(a | b);
+	a >>= __builtin_ctzll(a);
+
+	do {
+		b >>= __builtin_ctzll(b);
+		if (a > b) {
+			t = a;
+			a = b;
+			b = t;
+		}
+		b ^= a;
+	} while (b != 0);
+
+	return (a << k);
+}
+
+void
+mbin_xor2_gcd_array_64(const uint64_t *pa, const uint64_t *pb, uint64_t *pc, size_t num)
+{
+	size_t x;
+
+	for (x = 0; x != num; x++)
+		pc[x] = mbin_xor2_gcd_64(pa[x], pb[x]);
 }
 
 /* extended Euclidean equation for CRC */
@@ -1547,13 +1575,19 @@ mbin_xor2_gcd_extended_64(uint64_t a, uint64_t b, uint64_t *pa, uint64_t *pb)
 	uint64_t q;
 	uint64_t an;
 	uint64_t bn;
+	int n;
 
 	while (b != 0) {
-		q = mbin_xor2_div_64(a, b);
-		an = b;
-		bn = mbin_xor2_mod_64(a, b);
-		a = an;
-		b = bn;
+		/* compute quotient and remainder in one pass */
+		q = 0;
+		an = a;
+		while (an != 0 &&
+		    (n = __builtin_clzll(b) - __builtin_clzll(an)) >= 0) {
+			an ^= b << n;
+			q |= 1ULL << n;
+		}
+		a = b;
+		b = an;
 		an = lastx ^ mbin_xor2_mul_64(q, x);
 		bn = x;
 		x = an;
@@ -1567,6 +1601,195 @@ mbin_xor2_gcd_extended_64(uint64_t a, uint64_t b, uint64_t *pa, uint64_t *pb)
 	*pb = lasty;
 }
 
+/*
+ * Factorisation of polynomials over GF(2), using a square-free
+ * factorisation followed by distinct-degree and equal-degree
+ * (Cantor-Zassenhaus) factorisation.
+ */
+static uint8_t
+mbin_xor2_degree_64(uint64_t x)
+{
+	return (mbin_sumbits64(mbin_msb64(x) - 1ULL));
+}
+
+/* random numbers for the equal-degree factorisation */
+static uint64_t
+mbin_xor_factor_random_64(uint64_t *pseed)
+{
+	uint64_t x = *pseed;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	*pseed = x;
+	return (x);
+}
+
+/* "x" must be a product of distinct irreducibles of degree "d" */
+static uint32_t
+mbin_xor2_factor_edf_64(uint64_t x, uint8_t d, uint64_t *pfact, uint64_t *pseed)
+{
+	uint8_t n = mbin_xor2_degree_64(x);
+	uint64_t a;
+	uint64_t t;
+	uint64_t g;
+	uint8_t i;
+
+	if (n == d) {
+		pfact[0] = x;
+		return (1);
+	}
+	while (1) {
+		a = mbin_xor_factor_random_64(pseed) & (mbin_msb64(x) - 1ULL);
+		if (a <= 1)
+			continue;
+
+		/* compute the trace, a + a**2 + ... + a**(2**(d-1)) */
+		for (t = a, i = 1; i != d; i++) {
+			a = mbin_xor2_mul_mod_any_64(a, a, x);
+			t ^= a;
+		}
+		g = mbin_xor2_gcd_64(x, t);
+		if (g != 1 && g != x)
+			break;
+	}
+	n = mbin_xor2_factor_edf_64(g, d, pfact, pseed);
+	return (n + mbin_xor2_factor_edf_64(mbin_xor2_div_64(x, g), d, pfact + n, pseed));
+}
+
+/* "x" must be square-free */
+static uint32_t
+mbin_xor2_factor_ddf_64(uint64_t x, uint64_t *pfact, uint64_t *pseed)
+{
+	uint32_t num = 0;
+	uint64_t h = 2;
+	uint64_t g;
+	uint8_t d;
+
+	for (d = 1; 2 * d <= mbin_xor2_degree_64(x); d++) {
+		/* h = x**(2**d) modulo the remaining polynomial */
+		h = mbin_xor2_mul_mod_any_64(h, h, x);
+		g = mbin_xor2_gcd_64(x, h ^ 2);
+		if (g != 1) {
+			num += mbin_xor2_factor_edf_64(g, d, pfact + num, pseed);
+			x = mbin_xor2_div_64(x, g);
+			h = mbin_xor2_mod_64(h, x);
+		}
+	}
+	if (x != 1)
+		pfact[num++] = x;
+	return (num);
+}
+
+static uint32_t
+mbin_xor2_factor_sff_64(uint64_t x, uint64_t *pfact, uint64_t *pseed)
+{
+	uint64_t temp[64];
+	uint32_t num = 0;
+	uint32_t n;
+	uint32_t i;
+	uint32_t j;
+	uint32_t k;
+	uint64_t c;
+	uint64_t w;
+	uint64_t y;
+	uint64_t f;
+
+	/* the derivative keeps the odd powers */
+	c = mbin_xor2_gcd_64(x, (x / 2) & 0x5555555555555555ULL);
+	w = mbin_xor2_div_64(x, c);
+
+	for (i = 1; w != 1; i++) {
+		y = mbin_xor2_gcd_64(w, c);
+		f = mbin_xor2_div_64(w, y);
+		if (f != 1) {
+			n = mbin_xor2_factor_ddf_64(f, pfact + num, pseed);
+			/* repeat the factors "i" times */
+			for (j = 1; j != i; j++) {
+				for (k = 0; k != n; k++)
+					pfact[num + j * n + k] = pfact[num + k];
+			}
+			num += n * i;
+		}
+		w = y;
+		c = mbin_xor2_div_64(c, y);
+	}
+	if (c != 1) {
+		/* "c" is a square, compute the square root */
+		for (y = 0, j = 0; j < 64; j += 2) {
+			if (c & (1ULL << j))
+				y |= 1ULL << (j / 2);
+		}
+		n = mbin_xor2_factor_sff_64(y, temp, pseed);
+		for (k = 0; k != n; k++) {
+			pfact[num++] = temp[k];
+			pfact[num++] = temp[k];
+		}
+	}
+	return (num);
+}
+
+static int
+mbin_xor_factor_compare_64(const void *pa, const void *pb)
+{
+	uint64_t a = *(const uint64_t *)pa;
+	uint64_t b = *(const uint64_t *)pb;
+
+	return ((a > b) - (a < b));
+}
+
+/*
+ * Compute all irreducible factors of "x", with multiplicity and in
+ * increasing order. Returns the number of factors, at most 63.
+ */
+uint32_t
+mbin_xor2_factor_all_64(uint64_t x, uint64_t *pfact)
+{
+	uint64_t seed = 0x9E3779B97F4A7C15ULL ^ x;
+	uint32_t num;
+
+	if (x <= 1)
+		return (0);
+
+	num = mbin_xor2_factor_sff_64(x, pfact, &seed);
+	qsort(pfact, num, sizeof(pfact[0]), &mbin_xor_factor_compare_64);
+	return (num);
+}
+
+/*
+ * Rabin's irreducibility test. A polynomial "x" of degree "n" is
+ * irreducible if and only if it divides t**(2**n) - t, and t**(2**(n/q)) - t
+ * is coprime to "x" for every prime "q" dividing "n".
+ */
+uint8_t
+mbin_xor2_is_irreducible_64(uint64_t x)
+{
+	uint8_t n;
+	uint8_t q;
+	uint8_t m;
+	uint64_t t;
+
+	if (x <= 1)
+		return (0);
+
+	n = mbin_xor2_degree_64(x);
+	t = mbin_xor2_mod_64(2, x);
+
+	if (mbin_xor2_exp_mod_any_64(2, 1ULL << n, x) != t)
+		return (0);
+
+	for (m = n, q = 2; m != 1; q++) {
+		if ((m % q) != 0)
+			continue;
+		while ((m % q) == 0)
+			m /= q;
+		if (mbin_xor2_gcd_64(x,
+		    mbin_xor2_exp_mod_any_64(2, 1ULL << (n / q), x) ^ t) != 1)
+			return (0);
+	}
+	return (1);
+}
+
 void
 mbin_xor_print_mat_32(const uint32_t *table, uint32_t size, uint8_t print_invert)
 {
@@ -1946,6 +2169,281 @@ mbin_xor3_neg_mod_64(uint64_t x, uint8_t p, uint8_t q)
 	return (mbin_xor3_exp_mod_64(x, len, p, q));
 }
 
+/*
+ * Factorisation of polynomials over GF(3), using two bits per
+ * coefficient like the other XOR3 functions.
+ */
+#define	MBIN_XOR3_K 0x5555555555555555ULL
+
+static uint8_t
+mbin_xor3_degree_64(uint64_t x)
+{
+	return (mbin_sumbits64(mbin_msb64(x) - 1ULL) / 2);
+}
+
+static uint64_t
+mbin_xor3_neg_64(uint64_t x)
+{
+	return (((x & MBIN_XOR3_K) << 1) | ((x >> 1) & MBIN_XOR3_K));
+}
+
+static uint64_t
+mbin_xor3_sub_64(uint64_t a, uint64_t b)
+{
+	return (mbin_xor3_64(a, mbin_xor3_neg_64(b)));
+}
+
+/* make leading coefficient one */
+static uint64_t
+mbin_xor3_monic_64(uint64_t x)
+{
+	if (x != 0 && ((x >> (2 * mbin_xor3_degree_64(x))) & 3) == 2)
+		x = mbin_xor3_neg_64(x);
+	return (x);
+}
+
+/* polynomial division, any length */
+static uint64_t
+mbin_xor3_divmod_64(uint64_t rem, uint64_t div, uint64_t *pquot)
+{
+	uint64_t quot = 0;
+	uint8_t dd;
+	uint8_t dr;
+	uint8_t c;
+
+	if (div == 0) {
+		*pquot = 0;
+		return (rem);
+	}
+	dd = mbin_xor3_degree_64(div);
+	c = (div >> (2 * dd)) & 3;
+	if (c == 2)
+		div = mbin_xor3_neg_64(div);
+
+	while (rem != 0 && (dr = mbin_xor3_degree_64(rem)) >= dd) {
+		uint64_t t = ((rem >> (2 * dr)) & 3);
+
+		rem = mbin_xor3_sub_64(rem, ((t == 2) ?
+		    mbin_xor3_neg_64(div) : div) << (2 * (dr - dd)));
+
+		/* scale by the inverse of the leading coefficient */
+		if (c == 2)
+			t = 3 - t;
+		quot = mbin_xor3_64(quot, t << (2 * (dr - dd)));
+	}
+	*pquot = quot;
+	return (rem);
+}
+
+static uint64_t
+mbin_xor3_rem_64(uint64_t a, uint64_t b)
+{
+	uint64_t q;
+
+	return (mbin_xor3_divmod_64(a, b, &q));
+}
+
+static uint64_t
+mbin_xor3_quot_64(uint64_t a, uint64_t b)
+{
+	uint64_t q;
+
+	mbin_xor3_divmod_64(a, b, &q);
+	return (q);
+}
+
+/* monic greatest common divisor */
+static uint64_t
+mbin_xor3_gcd_64(uint64_t a, uint64_t b)
+{
+	uint64_t t;
+
+	while (b != 0) {
+		t = mbin_xor3_rem_64(a, b);
+		a = b;
+		b = t;
+	}
+	return (mbin_xor3_monic_64(a));
+}
+
+/* "x" must be a monic product of distinct irreducibles of degree "d" */
+static uint32_t
+mbin_xor3_factor_edf_64(uint64_t x, uint8_t d, uint64_t *pfact, uint64_t *pseed)
+{
+	uint8_t n = mbin_xor3_degree_64(x);
+	uint64_t a;
+	uint64_t r;
+	uint64_t g;
+	uint8_t i;
+
+	if (n == d) {
+		pfact[0] = x;
+		return (1);
+	}
+	while (1) {
+		a = mbin_xor_factor_random_64(pseed);
+		/* remove invalid digits and reduce the degree */
+		a &= ~((a & (a / 2) & MBIN_XOR3_K) * 3);
+		a &= (1ULL << (2 * n)) - 1ULL;
+		if (a == 0 || mbin_xor3_degree_64(a) == 0)
+			continue;
+
+		/* compute a**((3**d - 1) / 2) as a product of a**(3**i) */
+		for (r = a, i = 1; i != d; i++) {
+			a = mbin_xor3_qubic_mod_64(a, x);
+			r = mbin_xor3_mul_mod_any_64(r, a, x);
+		}
+		g = mbin_xor3_gcd_64(x, mbin_xor3_sub_64(r, 1));
+		if (g != 1 && g != x)
+			break;
+	}
+	n = mbin_xor3_factor_edf_64(g, d, pfact, pseed);
+	return (n + mbin_xor3_factor_edf_64(mbin_xor3_quot_64(x, g), d, pfact + n, pseed));
+}
+
+/* "x" must be monic and square-free */
+static uint32_t
+mbin_xor3_factor_ddf_64(uint64_t x, uint64_t *pfact, uint64_t *pseed)
+{
+	uint32_t num = 0;
+	uint64_t h = mbin_xor3_rem_64(4, x);
+	uint64_t g;
+	uint8_t d;
+
+	for (d = 1; 2 * d <= mbin_xor3_degree_64(x); d++) {
+		/* h = t**(3**d) modulo the remaining polynomial */
+		h = mbin_xor3_qubic_mod_64(h, x);
+		g = mbin_xor3_gcd_64(x, mbin_xor3_sub_64(h, 4));
+		if (g != 1) {
+			num += mbin_xor3_factor_edf_64(g, d, pfact + num, pseed);
+			x = mbin_xor3_quot_64(x, g);
+			h = mbin_xor3_rem_64(h, x);
+		}
+	}
+	if (x != 1)
+		pfact[num++] = x;
+	return (num);
+}
+
+/* "x" must be monic */
+static uint32_t
+mbin_xor3_factor_sff_64(uint64_t x, uint64_t *pfact, uint64_t *pseed)
+{
+	uint64_t temp[32];
+	uint32_t num = 0;
+	uint32_t n;
+	uint32_t i;
+	uint32_t j;
+	uint32_t k;
+	uint64_t c;
+	uint64_t w;
+	uint64_t y;
+	uint64_t f;
+
+	/* compute the derivative */
+	for (y = 0, i = 1; i != 32; i++) {
+		c = (x >> (2 * i)) & 3;
+		if ((i % 3) == 2)
+			c = mbin_xor3_neg_64(c);
+		else if ((i % 3) == 0)
+			c = 0;
+		y |= c << (2 * (i - 1));
+	}
+	c = mbin_xor3_gcd_64(x, y);
+	w = mbin_xor3_quot_64(x, c);
+
+	for (i = 1; w != 1; i++) {
+		y = mbin_xor3_gcd_64(w, c);
+		f = mbin_xor3_quot_64(w, y);
+		if (f != 1) {
+			n = mbin_xor3_factor_ddf_64(f, pfact + num, pseed);
+			/* repeat the factors "i" times */
+			for (j = 1; j != i; j++) {
+				for (k = 0; k != n; k++)
+					pfact[num + j * n + k] = pfact[num + k];
+			}
+			num += n * i;
+		}
+		w = y;
+		c = mbin_xor3_quot_64(c, y);
+	}
+	if (c != 1) {
+		/* "c" is a cube, compute the cube root */
+		for (y = 0, j = 0; j < 32; j += 3)
+			y |= ((c >> (2 * j)) & 3) << (2 * (j / 3));
+		n = mbin_xor3_factor_sff_64(y, temp, pseed);
+		for (k = 0; k != n; k++) {
+			pfact[num++] = temp[k];
+			pfact[num++] = temp[k];
+			pfact[num++] = temp[k];
+		}
+	}
+	return (num);
+}
+
+/*
+ * Compute all irreducible factors of "x", with multiplicity and in
+ * increasing order. The factors are monic. If the leading coefficient
+ * of "x" is two, the constant two is returned as an extra factor.
+ * Returns the number of factors, at most 32.
+ */
+uint32_t
+mbin_xor3_factor_all_64(uint64_t x, uint64_t *pfact)
+{
+	uint64_t seed = 0x9E3779B97F4A7C15ULL ^ x;
+	uint32_t num = 0;
+
+	if (x == 0 || mbin_xor3_degree_64(x) == 0)
+		return (0);
+
+	if (mbin_xor3_monic_64(x) != x) {
+		pfact[num++] = 2;
+		x = mbin_xor3_neg_64(x);
+	}
+	num += mbin_xor3_factor_sff_64(x, pfact + num, &seed);
+	qsort(pfact, num, sizeof(pfact[0]), &mbin_xor_factor_compare_64);
+	return (num);
+}
+
+/* Rabin's irreducibility test, see mbin_xor2_is_irreducible_64() */
+uint8_t
+mbin_xor3_is_irreducible_64(uint64_t x)
+{
+	uint64_t p;
+	uint64_t t;
+	uint8_t n;
+	uint8_t q;
+	uint8_t m;
+	uint8_t i;
+
+	if (x == 0)
+		return (0);
+	n = mbin_xor3_degree_64(x);
+	if (n == 0)
+		return (0);
+
+	x = mbin_xor3_monic_64(x);
+	t = mbin_xor3_rem_64(4, x);
+
+	for (p = 1, i = 0; i != n; i++)
+		p *= 3;
+	if (mbin_xor3_exp_mod_any_64(t, p, x) != t)
+		return (0);
+
+	for (m = n, q = 2; m != 1; q++) {
+		if ((m % q) != 0)
+			continue;
+		while ((m % q) == 0)
+			m /= q;
+		for (p = 1, i = 0; i != n / q; i++)
+			p *= 3;
+		if (mbin_xor3_gcd_64(x, mbin_xor3_sub_64(
+		    mbin_xor3_exp_mod_any_64(t, p, x), t)) != 1)
+			return (0);
+	}
+	return (1);
+}
+
 uint8_t
 mbin_xor3_find_mod_64(uint8_t *pbit, uint8_t *qbit, uint64_t *plen)
 {
@@ -0,0 +1,99 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Regression test for mbin_eq_mod_solve_ctx_32() with a table which
+ * is not reduced on input. The result must match mbin_eq_mod_solve_32()
+ * given the same table reduced. Build with:
+ *
+ * cc -I.. -o test_eq_mod test_eq_mod.c -lmbin1 -lpthread
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "math_bin.h"
+
+#define	TEST_MAX 8
+
+static int
+test_solve(int32_t *pmod, size_t max, const int32_t *input)
+{
+	struct mbin_eq_mod_32 *ctx;
+	int32_t ref[2 * TEST_MAX * TEST_MAX];
+	int bad;
+
+	ctx = mbin_eq_mod_alloc_32(pmod, max);
+	if (ctx == NULL)
+		return (1);
+
+	for (size_t x = 0; x != 2 * max * max; x++) {
+		ctx->table[x] = input[x];
+		ref[x] = input[x] % pmod[x % max];
+	}
+	mbin_eq_mod_solve_32(ref, pmod, max);
+	mbin_eq_mod_solve_ctx_32(ctx, 1);
+
+	bad = (memcmp(ref, ctx->table, 2 * max * max * sizeof(ref[0])) != 0);
+	mbin_eq_mod_free_32(ctx);
+	return (bad);
+}
+
+int
+main(void)
+{
+	int32_t input[2 * TEST_MAX * TEST_MAX];
+	int32_t pmod[TEST_MAX] = { 2147483629, 3 };
+	int bad = 0;
+
+	/* a large and a small modulus */
+	memset(input, 0, sizeof(input));
+	input[0] = 5;
+	input[1] = 2000000000;
+	bad += test_solve(pmod, 2, input);
+
+	srand(1);
+
+	for (size_t max = 1; max != TEST_MAX; max++) {
+		mbin_eq_mod_gen_32(pmod, max, NULL, NULL);
+
+		for (int x = 0; x != 100; x++) {
+			for (size_t y = 0; y != 2 * max * max; y++) {
+				input[y] = rand() - (RAND_MAX / 2);
+				if (rand() % 3 == 0)
+					input[y] = 0;
+			}
+			bad += test_solve(pmod, max, input);
+		}
+	}
+	if (bad != 0) {
+		printf("FAIL %d\n", bad);
+		return (1);
+	}
+	printf("PASS\n");
+	return (0);
+}
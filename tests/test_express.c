@@ -0,0 +1,174 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Regression test for moving an AND node between two expressions
+ * using the public dequeue and enqueue functions, and duplicating
+ * the result. Nodes dequeued by the caller must also survive the
+ * expression they came from. Also pins how mbin_expr_optimise()
+ * merges statements. Build with:
+ *
+ * cc -I.. -o test_express test_express.c -lmbin1 -lpthread
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "math_bin.h"
+
+static int
+test_move(int order)
+{
+	struct mbin_expr *pa;
+	struct mbin_expr *pb;
+	struct mbin_expr *pc;
+	struct mbin_expr_xor *pxa;
+	struct mbin_expr_xor *pxb;
+	struct mbin_expr_and *pand;
+	char types[4];
+	int num;
+
+	pa = mbin_expr_parse("(a0&b0)");
+	pb = mbin_expr_parse("(c0)");
+	if (pa == NULL || pb == NULL)
+		return (1);
+
+	pxa = mbin_expr_foreach_xor(pa, NULL);
+	pxb = mbin_expr_foreach_xor(pb, NULL);
+	pand = mbin_expr_foreach_and(pxa, NULL);
+
+	/* move "b0" from the first expression into the second */
+	mbin_expr_dequeue_and(pxa, pand);
+	mbin_expr_enqueue_and(pxb, pand);
+
+	pc = mbin_expr_dup(pb);
+	if (pc == NULL)
+		return (1);
+
+	/* the expressions can be freed in any order */
+	if (order == 0) {
+		mbin_expr_free(pa);
+		mbin_expr_free(pb);
+	} else {
+		mbin_expr_free(pb);
+		mbin_expr_free(pa);
+	}
+
+	mbin_expr_print(pc);
+	printf("\n");
+
+	num = 0;
+	pxb = mbin_expr_foreach_xor(pc, NULL);
+	for (pand = NULL; (pand = mbin_expr_foreach_and(pxb, pand)) != NULL; ) {
+		if (num == 4)
+			return (1);
+		types[num++] = mbin_expr_get_type_and(pand);
+	}
+	mbin_expr_free(pc);
+
+	return (num != 1 || types[0] != 'b');
+}
+
+static int
+test_detach(void)
+{
+	struct mbin_expr *pa;
+	struct mbin_expr_xor *pxor;
+	struct mbin_expr_and *pand;
+	int bad = 0;
+
+	pa = mbin_expr_alloc();
+	if (pa == NULL)
+		return (1);
+	pxor = mbin_expr_alloc_xor(pa);
+	if (pxor == NULL)
+		return (1);
+	mbin_expr_set_value_xor(pxor, 5);
+
+	/* the caller owns the XOR node once it is dequeued */
+	mbin_expr_dequeue_xor(pa, pxor);
+	mbin_expr_free(pa);
+	bad |= (mbin_expr_get_value_xor(pxor) != 5);
+	mbin_expr_free_xor(NULL, pxor);
+
+	pa = mbin_expr_parse("(a0&b0)");
+	if (pa == NULL)
+		return (1);
+	pxor = mbin_expr_foreach_xor(pa, NULL);
+	pand = mbin_expr_foreach_and(pxor, NULL);
+
+	/* the same for an AND node */
+	mbin_expr_dequeue_and(pxor, pand);
+	mbin_expr_free(pa);
+	bad |= (mbin_expr_get_type_and(pand) != 'b');
+	mbin_expr_free_and(NULL, pand);
+
+	return (bad);
+}
+
+/* statements with the same set of AND expressions are merged */
+static int
+test_optimise(void)
+{
+	struct mbin_expr *pa;
+	struct mbin_expr_xor *pxor;
+	struct mbin_expr_and *pand;
+	uint32_t value[4];
+	int len[4];
+	int num;
+
+	pa = mbin_expr_parse("(0x5&a0&a0)^(0x3&a0)^(0x9&a0&b0)");
+	if (pa == NULL)
+		return (1);
+	mbin_expr_optimise(pa, -1U);
+
+	num = 0;
+	for (pxor = NULL; (pxor = mbin_expr_foreach_xor(pa, pxor)) != NULL; ) {
+		if (num == 4)
+			return (1);
+		value[num] = mbin_expr_get_value_xor(pxor);
+		len[num] = 0;
+		for (pand = NULL; (pand = mbin_expr_foreach_and(pxor, pand)) != NULL; )
+			len[num]++;
+		num++;
+	}
+	mbin_expr_free(pa);
+
+	return (num != 2 || value[0] != 0x6 || len[0] != 2 ||
+	    value[1] != 0x9 || len[1] != 2);
+}
+
+int
+main(void)
+{
+	if (test_move(0) || test_move(1) || test_detach() ||
+	    test_optimise()) {
+		printf("FAIL\n");
+		return (1);
+	}
+	printf("PASS\n");
+	return (0);
+}
@@ -0,0 +1,96 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Regression test for mbin_recode_apply() working in place, for all
+ * plan types. Build with:
+ *
+ * cc -I.. -o test_recode test_recode.c -lmbin1 -lpthread
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "math_bin.h"
+
+#define	TEST_NUM 100
+
+int
+main(void)
+{
+	static struct mbin_recode_plan plan;
+	uint32_t ref[TEST_NUM];
+	uint32_t buf[TEST_NUM];
+	uint32_t ptr[32];
+	uint8_t premap[32];
+	uint8_t t;
+	int bad = 0;
+	int a;
+	int b;
+	int x;
+	int y;
+
+	srand(1);
+
+	for (x = 0; x != 200; x++) {
+		/* permutation of bits, with a varying number of swaps */
+		for (y = 0; y != 32; y++)
+			premap[y] = y;
+		for (y = 0; y != ((x % 3) ? (x % 5) : 32); y++) {
+			a = rand() % 32;
+			b = rand() % 32;
+			t = premap[a];
+			premap[a] = premap[b];
+			premap[b] = t;
+		}
+		for (y = 0; y != 32; y++)
+			ptr[y] = (x & 1) ? (uint32_t)rand() : (uint32_t)(rand() % 3);
+
+		for (y = 0; y != TEST_NUM; y++)
+			buf[y] = ((uint32_t)rand() * 3U) ^ (uint32_t)rand();
+
+		mbin_recodeA_compile(&plan, premap);
+		for (y = 0; y != TEST_NUM; y++)
+			ref[y] = mbin_recodeA_fwd32(buf[y], premap);
+		mbin_recode_apply(&plan, buf, buf, TEST_NUM);
+		if (memcmp(buf, ref, sizeof(ref)) != 0)
+			bad++;
+
+		mbin_recodeB_compile(&plan, ptr);
+		for (y = 0; y != TEST_NUM; y++)
+			ref[y] = mbin_recodeB_fwd32(buf[y], ptr);
+		mbin_recode_apply(&plan, buf, buf, TEST_NUM);
+		if (memcmp(buf, ref, sizeof(ref)) != 0)
+			bad++;
+	}
+	if (bad != 0) {
+		printf("FAIL %d\n", bad);
+		return (1);
+	}
+	printf("PASS\n");
+	return (0);
+}